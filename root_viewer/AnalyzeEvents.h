@@ -1,83 +1,131 @@
-#include <iostream>
-#include <fstream>
-#include <sstream>
+// AnalyzeEvents.h
+#ifndef ANALYZEEVENTS_H
+#define ANALYZEEVENTS_H
+
+#include <memory>
 #include <string>
 #include <vector>
 
-#include "TTree.h"
 #include "TFile.h"
-#include "TString.h"
-#include "TObject.h"
-
-struct RunInfo : public TObject {
-  Float_t SimStartAreaFarField; 
-  TString BeamType;
-  Float_t BeamTheta;
-  Float_t BeamPhi;
-  TString SpectralType;
-  Float_t SpectralEnergy;
-     
-  ClassDef(RunInfo, 1)
-};
-
-// lines with IA
-
-struct InteractionData : public TObject {
-  TString Type; 
-  Int_t Index;
-  // Int_t InteractionID;
-  Int_t ParentInteractionID;
-  Int_t DetectorID;
-  Double_t Time; 
-  Float_t X, Y, Z;
-  Int_t MotherParticleCode;
-  Float_t Px_in, Py_in, Pz_in;
-  Float_t Dx_in, Dy_in, Dz_in;
-  Float_t Energy_in;
-  Int_t OutgoingParticleCode;
-  Float_t Px_out, Py_out, Pz_out;
-  Float_t Dx_out, Dy_out, Dz_out;
-  Float_t Energy_out;
-
-
-  ClassDef(InteractionData, 1) 
-};
-ClassImp(InteractionData)
-
-
-// Lines with HITSim 
-
-struct HitData : public TObject {
-    Int_t Index;
-    Float_t X, Y, Z;
-    Float_t EnergyDeposit;
-    Double_t Time;
-    Int_t Multiplicity;
-    std::vector<Int_t> PrimaryParticleIDs; 
-
-    ClassDef(HitData, 1)
-};
-ClassImp(HitData)
-
-
-// Saving main event informations
-// Event block starts with SE
-
-struct EventData : public TObject {
-  Int_t TriggerID = 0; 
-  Int_t EventID;
-  Double_t InitialTime;
-  Float_t TotDepositedEnergy;
-  Float_t EscapedEnergy; //guess
-  Float_t NSMaterialEnergy;
-  TString PhysicsModuleType;
-  Float_t PhysicsModuleEnergy;
-
-  std::vector<InteractionData> Interactions;
-  std::vector<HitData> Hits;
+#include "TH1.h"
+#include "TH2.h"
+#include "TTree.h"
 
-  ClassDef(EventData, 1)
+#include "EventData.h"
+#include "EventConsumer.h"
+#include "QuantileSketch.h"
+
+// ===================================================================
+// Histogram filler of AnalyzeEvents, usable as a consumer of the
+// single-pass pipeline (Begin/Consume/End) or fed from a TTree.
+//
+// The per-event quantities go to a compact TTree "EventSeries" in the
+// output file (TriggerID, Edep, Eesc, Ensm, LayerMask: bit l-1 set if
+// tracker layer l has a hit), written while the events are analyzed;
+// the per-event plots are built from it on demand (PlotEventSeries in
+// ProducePlots.C), so memory does not grow with the number of events.
+//
+// The ALL/MAX Edep spectra are also kept as QuantileSketch objects
+// ("qsEdepTrackerLayerALL/MAX"), for percentiles without the binning
+// and the 1000 keV range of the histograms; BeamEnergy is saved as a
+// TParameter<double>.
+// ===================================================================
+class EventAnalyzer : public EventConsumer {
+ public:
+  // BeamEnergy < 0: taken from RunInfo::SpectralEnergy in Begin()
+  explicit EventAnalyzer(const char* output_filename, double BeamEnergy = -1.);
+  ~EventAnalyzer() override;
+
+  void Begin(const RunInfo& runInfo) override;
+  void Consume(const EventData& event) override;
+  void End() override;
+
+  // books the histograms and opens the output file for the series
+  // (called by Begin, or directly when there is no RunInfo)
+  void Book(double BeamEnergy);
+
+  Long64_t GetEventCount() const { return fNEvents; }
+
+  // Multi-thread analysis: a shard has its own histograms (not attached
+  // to gDirectory) and writes its series to its own temporary file
+  // (<output>.shardN.part); it is filled by one worker and Merge() adds
+  // it to this analyzer, copying the series and removing the file.
+  // Shards must be merged in entry order, so that the EventSeries keeps
+  // the serial order.
+  std::unique_ptr<EventAnalyzer> CloneShard() const;
+  void Merge(EventAnalyzer& shard);
+
+ private:
+  std::vector<TH1*> Histograms() const;
+
+  // one entry of the EventSeries tree
+  struct SeriesEntry {
+    Int_t    TriggerID;
+    Float_t  Edep;
+    Float_t  Eesc;
+    Float_t  Ensm;
+    UShort_t LayerMask;
+  };
+  void Record(const SeriesEntry& entry);
+
+  std::string fOutputFilename;
+  double      fBeamEnergy;
+  bool        fBooked = false;
+  bool        fIsShard = false;   // owns its histograms, temporary output file
+  Long64_t    fNEvents = 0;
+  mutable int fNShards = 0;       // shards cloned so far (temporary file names)
+
+  TFile*                   fOutFile = nullptr;
+  TTree*                   fSeries  = nullptr;
+  SeriesEntry              fEntry{};
+
+  TH2F* h2Etot                           = nullptr;
+  TH2F* h2EdepTrackerVsZ                 = nullptr;
+  TH2F* Ph2EdepTrackerVsZ                = nullptr;
+  TH2F* h2TrackerXvsY                    = nullptr;
+  TH1F* hEdepTrackerLayerMAX             = nullptr;
+  TH1F* hEdepTrackerLayerALL             = nullptr;
+  TH1F* hEdepTrackerLayerNoCopper        = nullptr;
+  TH1F* hEdepTrackerLayerNoCopperMJ55    = nullptr;
+  TH1F* hEdepTrackerLayerNoCopperMJ55FEE = nullptr;
+  TH2F* hEdepTrackerLayerMultiplicity    = nullptr;
+  TH1F* hLayerMultiplicity               = nullptr;
+  TH1F* hClusterSize                     = nullptr;
+
+  QuantileSketch qsEdepTrackerLayerALL;
+  QuantileSketch qsEdepTrackerLayerMAX;
 };
-ClassImp(EventData)
-
 
+// core: analisi di un TTree "Events" o "EventsFlat"; nThreads != 1:
+// entry divise fra i thread (nThreads <= 0: tutti i core), serve un
+// TTree letto da file
+void AnalyzeEvents(TTree* tree, double BeamEnergy, const char* output_filename,
+                   int nThreads = 1);
+
+// vecchio uso: .sim.root -> .ana.root
+void AnalyzeEvents(const char* input_filename_char, int nThreads = 1);
+
+// pipeline completa in un solo passaggio: .sim / .sim.gz -> .ana.root
+// (+ .sim.root se sim_root_output != nullptr); extra: altri consumer
+// (es. EventListCollector) alimentati dallo stesso passaggio;
+// ana_output: nome del .ana.root (nullptr: ricavato dal .sim).
+// false se il run fallisce (input illeggibile o troncato, nessun evento):
+// in quel caso il .ana.root non viene scritto
+bool ProcessSimFileWith(const char*                        sim_filename_char,
+                        const std::vector<EventConsumer*>& extra,
+                        int                                nThreads = 1,
+                        const char*                        sim_root_output = nullptr,
+                        const char*                        ana_output = nullptr);
+
+void ProcessSimFile(const char* sim_filename_char, int nThreads = 1,
+                    const char* sim_root_output = nullptr);
+
+// come ProcessSimFile, con il nome del .ana.root esplicito (run_campaign.py);
+// false se il run fallisce
+bool ProcessSimFileTo(const char* sim_filename_char, const char* ana_output,
+                      int nThreads = 1, const char* sim_root_output = nullptr);
+
+void ProcessSimGzFile(const char* sim_gz_filename_char,
+                      const char* sim_root_output = nullptr);
+
+#endif // ANALYZEEVENTS_H
@@ -0,0 +1,28 @@
+#ifndef EVENTCONSUMER_H
+#define EVENTCONSUMER_H
+
+struct RunInfo;
+struct EventData;
+
+// -------------------------------------------------------------------
+// Visitor for the single-pass pipeline: the parser hands every
+// finished event to each attached consumer, in file order, so one
+// read of a .sim file can feed the analysis, the event lists and an
+// optional .sim.root writer together (see parse_sim_file_to_consumers).
+// -------------------------------------------------------------------
+class EventConsumer {
+ public:
+  virtual ~EventConsumer() = default;
+
+  // Called once, after the run header (up to TB) has been parsed
+  virtual void Begin(const RunInfo& runInfo) { (void) runInfo; }
+
+  // Called for every complete event; the reference is only valid
+  // during the call (the parser reuses the object)
+  virtual void Consume(const EventData& event) = 0;
+
+  // Called once, after the last event
+  virtual void End() {}
+};
+
+#endif
@@ -0,0 +1,263 @@
+// EventIndex.h
+#ifndef EVENTINDEX_H
+#define EVENTINDEX_H
+
+// ===================================================================
+// Sidecar index of an events file: TTree "EventIndex" in <run>.idx.root
+// (run.sim.root / run.flat.root -> run.idx.root), one entry per event,
+// same entry numbers as the "Events" / "EventsFlat" tree.
+//
+// Per event: EventID, TriggerID, PhysicsModuleType as a dictionary code
+// (names in the UserInfo, "PhysicsModuleTypes"), hit counts, min / max /
+// sum of the hit energies and the 10-bit mask of the layers hit (bit
+// l-1 for layer l), both for the tracker hits (Index == 1) and for all
+// the hits. EventListTools answers energy / layer / module selections
+// from these few leaves and reads the hit vectors only for the events
+// the index cannot decide (see EventListTools.C).
+//
+// Written by EventIndexWriter, a consumer of the single-pass pipeline
+// (parse_and_fill_tree_flat, ProcessSimFileWith with a .sim.root), or
+// afterwards from an events file with BuildEventIndex().
+// ===================================================================
+
+#include "TFile.h"
+#include "TList.h"
+#include "TObjArray.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include "EventData.h"
+#include "EventConsumer.h"
+#include "FlatEvents.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// Z (cm) -> tracker layer 1..10, 0 if below the tracker (same ladder as AnalyzeEvents.C)
+inline int EventLayerFromZ(float z_cm)
+{
+  float current_Z_limit = 11.5f;
+  for (int layer = 1; layer <= 10; ++layer) {
+    if (z_cm > current_Z_limit) return layer;
+    current_Z_limit -= 1.5f;
+  }
+  return 0;
+}
+
+// <run>.sim.root / <run>.flat.root / <run>.root -> <run>.idx.root
+inline std::string EventIndexFileFor(const std::string& eventsFile)
+{
+  std::string base = eventsFile;
+  const std::string suffixes[] = { ".root", ".sim", ".flat" };
+  for (const std::string& suffix : suffixes) {
+    if (base.size() > suffix.size() &&
+        base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      base.erase(base.size() - suffix.size());
+    }
+  }
+  return base + ".idx.root";
+}
+
+// -------------------------------------------------------------------
+// One entry of the index
+// -------------------------------------------------------------------
+struct EventSummary {
+  Int_t    EventID      = 0;
+  Int_t    TriggerID    = 0;
+  Int_t    Module       = -1;   // PhysicsModuleType code
+  Int_t    nHits        = 0;
+  Int_t    nTrackerHits = 0;    // hits with Index == 1
+  Float_t  EdepMin      = 0;    // tracker hits
+  Float_t  EdepMax      = 0;
+  Float_t  EdepSum      = 0;
+  Float_t  AllEdepMin   = 0;    // all hits
+  Float_t  AllEdepMax   = 0;
+  Float_t  AllEdepSum   = 0;
+  UShort_t LayerMask    = 0;    // tracker hits
+  UShort_t AllLayerMask = 0;    // all hits
+
+  void Fill(const EventData& event, FlatDictionary& modules)
+  {
+    *this     = EventSummary();
+    EventID   = event.EventID;
+    TriggerID = event.TriggerID;
+    Module    = modules.Code(event.PhysicsModuleType);
+    nHits     = static_cast<Int_t>(event.Hits.size());
+
+    for (const HitData& hit : event.Hits) {
+      const float    e     = hit.EnergyDeposit;
+      const int      l     = EventLayerFromZ(hit.Z);
+      const UShort_t bit   = l > 0 ? static_cast<UShort_t>(1u << (l - 1)) : 0;
+      const bool     first = &hit == &event.Hits.front();
+
+      AllEdepMin    = first ? e : std::min(AllEdepMin, e);
+      AllEdepMax    = first ? e : std::max(AllEdepMax, e);
+      AllEdepSum   += e;
+      AllLayerMask |= bit;
+
+      if (hit.Index != 1) continue;
+      EdepMin    = nTrackerHits == 0 ? e : std::min(EdepMin, e);
+      EdepMax    = nTrackerHits == 0 ? e : std::max(EdepMax, e);
+      EdepSum   += e;
+      LayerMask |= bit;
+      ++nTrackerHits;
+    }
+  }
+
+  void Branch(TTree& tree)
+  {
+    tree.Branch("EventID",      &EventID,      "EventID/I");
+    tree.Branch("TriggerID",    &TriggerID,    "TriggerID/I");
+    tree.Branch("Module",       &Module,       "Module/I");
+    tree.Branch("nHits",        &nHits,        "nHits/I");
+    tree.Branch("nTrackerHits", &nTrackerHits, "nTrackerHits/I");
+    tree.Branch("EdepMin",      &EdepMin,      "EdepMin/F");
+    tree.Branch("EdepMax",      &EdepMax,      "EdepMax/F");
+    tree.Branch("EdepSum",      &EdepSum,      "EdepSum/F");
+    tree.Branch("AllEdepMin",   &AllEdepMin,   "AllEdepMin/F");
+    tree.Branch("AllEdepMax",   &AllEdepMax,   "AllEdepMax/F");
+    tree.Branch("AllEdepSum",   &AllEdepSum,   "AllEdepSum/F");
+    tree.Branch("LayerMask",    &LayerMask,    "LayerMask/s");
+    tree.Branch("AllLayerMask", &AllLayerMask, "AllLayerMask/s");
+  }
+
+  void Attach(TTree& tree)
+  {
+    tree.SetBranchAddress("EventID",      &EventID);
+    tree.SetBranchAddress("TriggerID",    &TriggerID);
+    tree.SetBranchAddress("Module",       &Module);
+    tree.SetBranchAddress("nHits",        &nHits);
+    tree.SetBranchAddress("nTrackerHits", &nTrackerHits);
+    tree.SetBranchAddress("EdepMin",      &EdepMin);
+    tree.SetBranchAddress("EdepMax",      &EdepMax);
+    tree.SetBranchAddress("EdepSum",      &EdepSum);
+    tree.SetBranchAddress("AllEdepMin",   &AllEdepMin);
+    tree.SetBranchAddress("AllEdepMax",   &AllEdepMax);
+    tree.SetBranchAddress("AllEdepSum",   &AllEdepSum);
+    tree.SetBranchAddress("LayerMask",    &LayerMask);
+    tree.SetBranchAddress("AllLayerMask", &AllLayerMask);
+  }
+};
+
+// -------------------------------------------------------------------
+// Consumer that writes the index (see EventConsumer.h)
+// -------------------------------------------------------------------
+class EventIndexWriter : public EventConsumer {
+ public:
+  explicit EventIndexWriter(const char* outputFile) : fOutputFile(outputFile) {}
+  // End() never reached (parse error, truncated input): no partial index
+  ~EventIndexWriter() override
+  {
+    if (!fFile) return;
+    delete fFile;
+    gSystem->Unlink(fOutputFile.c_str());
+  }
+
+  void Begin(const RunInfo& runInfo) override
+  {
+    (void) runInfo;
+    TDirectory::TContext restoreDirectory;
+    fFile = new TFile(fOutputFile.c_str(), "RECREATE");
+    if (fFile->IsZombie()) {
+      std::cerr << "Error: Could not create output file " << fOutputFile << std::endl;
+      delete fFile;
+      fFile = nullptr;
+      return;
+    }
+    fTree = new TTree("EventIndex", "Per-event summary of the hits");
+    fSummary.Branch(*fTree);
+  }
+
+  void Consume(const EventData& event) override
+  {
+    if (!fTree) return;
+    fSummary.Fill(event, fModules);
+    fTree->Fill();
+  }
+
+  void End() override
+  {
+    if (!fFile) return;
+    TDirectory::TContext restoreDirectory(fFile);
+    fTree->GetUserInfo()->Add(fModules.ToArray("PhysicsModuleTypes"));
+    fTree->Write();
+    std::cout << "Saved index of " << fTree->GetEntries() << " events to " << fOutputFile << std::endl;
+    fFile->Close();
+    delete fFile;
+    fFile = nullptr;
+    fTree = nullptr;
+  }
+
+ private:
+  std::string    fOutputFile;
+  TFile*         fFile = nullptr;
+  TTree*         fTree = nullptr;
+  EventSummary   fSummary;
+  FlatDictionary fModules;
+};
+
+// -------------------------------------------------------------------
+// Reads the index of an events file; IsValid() is false if the index
+// is missing, older than the events file or has a different number of
+// entries (then the caller scans the events)
+// -------------------------------------------------------------------
+class EventIndexReader {
+ public:
+  EventIndexReader(const char* eventsFile, Long64_t nEvents)
+  {
+    const std::string indexFile = EventIndexFileFor(eventsFile);
+    if (gSystem->AccessPathName(indexFile.c_str())) return; // no index
+
+    Long_t id = 0, flags = 0, eventsTime = 0, indexTime = 0;
+    Long64_t size = 0;
+    if (gSystem->GetPathInfo(eventsFile, &id, &size, &flags, &eventsTime) == 0 &&
+        gSystem->GetPathInfo(indexFile.c_str(), &id, &size, &flags, &indexTime) == 0 &&
+        indexTime < eventsTime) {
+      std::cerr << "WARNING: " << indexFile << " is older than " << eventsFile
+                << ", not used" << std::endl;
+      return;
+    }
+
+    fFile = TFile::Open(indexFile.c_str());
+    if (!fFile || fFile->IsZombie()) {
+      std::cerr << "WARNING: cannot open index " << indexFile << std::endl;
+      return;
+    }
+    fTree = dynamic_cast<TTree*>(fFile->Get("EventIndex"));
+    if (!fTree || fTree->GetEntries() != nEvents) {
+      std::cerr << "WARNING: " << indexFile << " does not match " << eventsFile
+                << ", not used" << std::endl;
+      fTree = nullptr;
+      return;
+    }
+    fSummary.Attach(*fTree);
+    fModules.FromArray(dynamic_cast<TObjArray*>(fTree->GetUserInfo()->FindObject("PhysicsModuleTypes")));
+  }
+
+  ~EventIndexReader()
+  {
+    if (fFile) fFile->Close();
+    delete fFile;
+  }
+
+  bool     IsValid()    const { return fTree != nullptr; }
+  Long64_t GetEntries() const { return fTree ? fTree->GetEntries() : 0; }
+
+  const EventSummary& GetEntry(Long64_t entry)
+  {
+    fTree->GetEntry(entry);
+    return fSummary;
+  }
+
+  // -1 if no event of the run has this PhysicsModuleType
+  Int_t ModuleCode(const std::string& name) const { return fModules.Find(name.c_str()); }
+
+ private:
+  TFile*         fFile = nullptr;
+  TTree*         fTree = nullptr;
+  EventSummary   fSummary;
+  FlatDictionary fModules;
+};
+
+#endif // EVENTINDEX_H
@@ -2,12 +2,18 @@
 #define EVENTLISTTOOLS_H
 
 #include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "EventConsumer.h"
+
 class TTree;
 
 // Selection configuration
 enum class SelectionMode {
   kEnergyRange,
-  kLayer
+  kLayer,
+  kCompound     // energy window AND layer, each one only if enabled (useEnergy / useLayer)
 };
 
 struct EventListConfig {
@@ -20,12 +26,23 @@ struct EventListConfig {
   // Layer selection (1..10)
   int layer = 1;
 
+  // kCompound: which of the two cuts above are applied (each one is
+  // "some hit of the event passes", as in kEnergyRange / kLayer)
+  bool useEnergy = false;
+  bool useLayer  = false;
+
   // Optional filters
   bool requireHitIndex1 = true;   // mimic your analyzer: consider only hits with hit.Index == 1
   bool uniqueEventIDs   = true;   // de-duplicate EventIDs
+  std::vector<std::string> excludeModules;  // reject events with these PhysicsModuleType (any mode)
 };
 
+// Selections on a file use its sidecar index <run>.idx.root when it
+// exists (see EventIndex.h): the hits are read only for the events the
+// index cannot decide. Without index, one pass over the events tree.
+
 // Print selected EventIDs to stdout
+// (input: TTree "EventsFlat" if present, otherwise "Events")
 void PrintEventList(const char* input_root_file, const EventListConfig& cfg);
 
 // Write selected EventIDs to a ROOT file (TTree "EventList", branch "EventID")
@@ -37,4 +54,39 @@ void WriteEventListRoot(const char* input_root_file,
 void PrintEventList(TTree* eventsTree, const EventListConfig& cfg);
 void WriteEventListRoot(TTree* eventsTree, const char* output_root_file, const EventListConfig& cfg);
 
+// Several selections in one pass: lists[i] are the EventIDs of cfgs[i]
+std::vector<std::vector<int>> CollectEventLists(const char* input_root_file,
+                                                const std::vector<EventListConfig>& cfgs);
+std::vector<std::vector<int>> CollectEventLists(TTree* eventsTree,
+                                                const std::vector<EventListConfig>& cfgs);
+
+// One pass, cfgs[i] written to output_root_files[i]
+void WriteEventListsRoot(const char* input_root_file,
+                         const std::vector<EventListConfig>& cfgs,
+                         const std::vector<std::string>& output_root_files);
+
+// Writes the sidecar index of an existing events file
+// (index_file == nullptr: <run>.idx.root, see EventIndexFileFor)
+bool BuildEventIndex(const char* input_root_file, const char* index_file = nullptr);
+
+// Consumer for the single-pass pipeline (see ProcessSimFileWith):
+// selects while the .sim is parsed, then at End() writes the list to
+// output_root_file, or prints it if output_root_file is null
+class EventListCollector : public EventConsumer {
+ public:
+  explicit EventListCollector(const EventListConfig& cfg, const char* output_root_file = nullptr);
+
+  void Consume(const EventData& event) override;
+  void End() override;
+
+  const std::vector<int>& GetEventIDs() const { return ids; }
+
+ private:
+  EventListConfig         cfg;
+  std::string             output;
+  std::vector<int>        ids;
+  std::unordered_set<int> seen;
+  bool                    valid;   // false: layer out of range, no event selected
+};
+
 #endif
@@ -0,0 +1,568 @@
+// FlatEvents.h
+#ifndef FLATEVENTS_H
+#define FLATEVENTS_H
+
+// ===================================================================
+// Columnar ("flat") layout of the parsed events: TTree "EventsFlat".
+//
+// One branch per field instead of the split EventData objects:
+//   - event scalars are plain leaves (PhysicsModuleType as a code),
+//     plus nHits / nInteractions;
+//   - every HitData / InteractionData field is a std::vector column
+//     with one value per hit / interaction (IA type as a code);
+//   - the primary particle IDs of all the hits of an event are
+//     concatenated in Hit_PIDs, Hit_PIDEnd[i] is the end offset of hit i.
+// The string dictionaries and the RunInfo are kept in the tree's
+// UserInfo, so an EventsFlat tree is self-contained.
+//
+// FlatEventReader reads back only the requested column groups into an
+// EventData, so the analysis code keeps using the object view
+// (event_display included: it reads either layout).
+// ===================================================================
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include "EventData.h"
+#include "EventConsumer.h"
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Column groups for FlatEventReader (nHits / nInteractions always read)
+enum FlatColumns : unsigned {
+  kFlatEvent        = 1u << 0,  // TriggerID, EventID, InitialTime, energies, PhysicsModule*
+  kFlatHitIndex     = 1u << 1,
+  kFlatHitXY        = 1u << 2,
+  kFlatHitZ         = 1u << 3,
+  kFlatHitEnergy    = 1u << 4,
+  kFlatHitTime      = 1u << 5,  // Time, Multiplicity
+  kFlatHitPIDs      = 1u << 6,
+  kFlatInteractions = 1u << 7,
+  kFlatHits         = kFlatHitIndex | kFlatHitXY | kFlatHitZ | kFlatHitEnergy
+                    | kFlatHitTime | kFlatHitPIDs,
+  kFlatAll          = kFlatEvent | kFlatHits | kFlatInteractions
+};
+
+// -------------------------------------------------------------------
+// String <-> code dictionary (IA types, PhysicsModuleType)
+// -------------------------------------------------------------------
+class FlatDictionary {
+ public:
+  Int_t Code(const TString& name)
+  {
+    const std::string key(name.Data(), name.Length());
+    auto it = fCodes.find(key);
+    if (it != fCodes.end()) return it->second;
+    const Int_t code = static_cast<Int_t>(fNames.size());
+    fNames.push_back(name);
+    fCodes.emplace(key, code);
+    return code;
+  }
+
+  // -1 if name is not in the dictionary
+  Int_t Find(const TString& name) const
+  {
+    auto it = fCodes.find(std::string(name.Data(), name.Length()));
+    return it != fCodes.end() ? it->second : -1;
+  }
+
+  const TString& Name(Int_t code) const
+  {
+    static const TString unknown;
+    return (code >= 0 && code < static_cast<Int_t>(fNames.size())) ? fNames[code] : unknown;
+  }
+
+  // owning TObjArray of TObjString, index = code
+  TObjArray* ToArray(const char* arrayName) const
+  {
+    TObjArray* array = new TObjArray();
+    array->SetName(arrayName);
+    array->SetOwner(kTRUE);
+    for (const TString& name : fNames) array->Add(new TObjString(name));
+    return array;
+  }
+
+  void FromArray(const TObjArray* array)
+  {
+    fNames.clear();
+    fCodes.clear();
+    if (!array) return;
+    for (Int_t i = 0; i < array->GetEntriesFast(); ++i) {
+      const TObjString* s = dynamic_cast<const TObjString*>(array->At(i));
+      Code(s ? s->GetString() : TString());
+    }
+  }
+
+ private:
+  std::vector<TString>                   fNames;
+  std::unordered_map<std::string, Int_t> fCodes;
+};
+
+// -------------------------------------------------------------------
+// One std::vector column bound to a member of S (HitData, InteractionData)
+// -------------------------------------------------------------------
+template <class S, class T>
+struct FlatColumn {
+  const char*    name;
+  T S::*         member;
+  unsigned       group;
+  std::vector<T> values;
+
+  void Store(const std::vector<S>& objects)
+  {
+    values.resize(objects.size());
+    for (size_t k = 0; k < objects.size(); ++k) values[k] = objects[k].*member;
+  }
+
+  void Load(std::vector<S>& objects) const
+  {
+    const size_t n = std::min(values.size(), objects.size());
+    for (size_t k = 0; k < n; ++k) objects[k].*member = values[k];
+  }
+};
+
+// -------------------------------------------------------------------
+// All the columns of one event, shared by writer and reader
+// -------------------------------------------------------------------
+class FlatEventColumns {
+ public:
+  FlatEventColumns()
+  {
+    hitInt    = { { "Hit_Index",         &HitData::Index,         kFlatHitIndex,  {} },
+                  { "Hit_Multiplicity",  &HitData::Multiplicity,  kFlatHitTime,   {} } };
+    hitFloat  = { { "Hit_X",             &HitData::X,             kFlatHitXY,     {} },
+                  { "Hit_Y",             &HitData::Y,             kFlatHitXY,     {} },
+                  { "Hit_Z",             &HitData::Z,             kFlatHitZ,      {} },
+                  { "Hit_EnergyDeposit", &HitData::EnergyDeposit, kFlatHitEnergy, {} } };
+    hitDouble = { { "Hit_Time",          &HitData::Time,          kFlatHitTime,   {} } };
+
+    const unsigned ia = kFlatInteractions;
+    iaInt    = { { "IA_Index",                &InteractionData::Index,                ia, {} },
+                 { "IA_ParentInteractionID",  &InteractionData::ParentInteractionID,  ia, {} },
+                 { "IA_DetectorID",           &InteractionData::DetectorID,           ia, {} },
+                 { "IA_MotherParticleCode",   &InteractionData::MotherParticleCode,   ia, {} },
+                 { "IA_OutgoingParticleCode", &InteractionData::OutgoingParticleCode, ia, {} } };
+    iaFloat  = { { "IA_X",          &InteractionData::X,          ia, {} },
+                 { "IA_Y",          &InteractionData::Y,          ia, {} },
+                 { "IA_Z",          &InteractionData::Z,          ia, {} },
+                 { "IA_Px_in",      &InteractionData::Px_in,      ia, {} },
+                 { "IA_Py_in",      &InteractionData::Py_in,      ia, {} },
+                 { "IA_Pz_in",      &InteractionData::Pz_in,      ia, {} },
+                 { "IA_Dx_in",      &InteractionData::Dx_in,      ia, {} },
+                 { "IA_Dy_in",      &InteractionData::Dy_in,      ia, {} },
+                 { "IA_Dz_in",      &InteractionData::Dz_in,      ia, {} },
+                 { "IA_Energy_in",  &InteractionData::Energy_in,  ia, {} },
+                 { "IA_Px_out",     &InteractionData::Px_out,     ia, {} },
+                 { "IA_Py_out",     &InteractionData::Py_out,     ia, {} },
+                 { "IA_Pz_out",     &InteractionData::Pz_out,     ia, {} },
+                 { "IA_Dx_out",     &InteractionData::Dx_out,     ia, {} },
+                 { "IA_Dy_out",     &InteractionData::Dy_out,     ia, {} },
+                 { "IA_Dz_out",     &InteractionData::Dz_out,     ia, {} },
+                 { "IA_Energy_out", &InteractionData::Energy_out, ia, {} } };
+    iaDouble = { { "IA_Time",       &InteractionData::Time,       ia, {} } };
+  }
+
+  // the columns are bound by address: no copies
+  FlatEventColumns(const FlatEventColumns&) = delete;
+  FlatEventColumns& operator=(const FlatEventColumns&) = delete;
+
+  // EventData -> columns
+  void Store(const EventData& event, FlatDictionary& iaTypes, FlatDictionary& modules)
+  {
+    TriggerID           = event.TriggerID;
+    EventID             = event.EventID;
+    InitialTime         = event.InitialTime;
+    TotDepositedEnergy  = event.TotDepositedEnergy;
+    EscapedEnergy       = event.EscapedEnergy;
+    NSMaterialEnergy    = event.NSMaterialEnergy;
+    PhysicsModuleType   = modules.Code(event.PhysicsModuleType);
+    PhysicsModuleEnergy = event.PhysicsModuleEnergy;
+    nHits               = static_cast<Int_t>(event.Hits.size());
+    nInteractions       = static_cast<Int_t>(event.Interactions.size());
+
+    for (auto& c : hitInt)    c.Store(event.Hits);
+    for (auto& c : hitFloat)  c.Store(event.Hits);
+    for (auto& c : hitDouble) c.Store(event.Hits);
+
+    hitPIDs.clear();
+    hitPIDEnd.resize(event.Hits.size());
+    for (size_t k = 0; k < event.Hits.size(); ++k) {
+      const auto& ids = event.Hits[k].PrimaryParticleIDs;
+      hitPIDs.insert(hitPIDs.end(), ids.begin(), ids.end());
+      hitPIDEnd[k] = static_cast<Int_t>(hitPIDs.size());
+    }
+
+    for (auto& c : iaInt)    c.Store(event.Interactions);
+    for (auto& c : iaFloat)  c.Store(event.Interactions);
+    for (auto& c : iaDouble) c.Store(event.Interactions);
+
+    iaType.resize(event.Interactions.size());
+    for (size_t k = 0; k < event.Interactions.size(); ++k) {
+      iaType[k] = iaTypes.Code(event.Interactions[k].Type);
+    }
+  }
+
+  // columns -> EventData, only the given groups (the other fields are
+  // left untouched, as with disabled branches)
+  void Load(EventData& event, unsigned columns,
+            const FlatDictionary& iaTypes, const FlatDictionary& modules) const
+  {
+    if (columns & kFlatEvent) {
+      event.TriggerID           = TriggerID;
+      event.EventID             = EventID;
+      event.InitialTime         = InitialTime;
+      event.TotDepositedEnergy  = TotDepositedEnergy;
+      event.EscapedEnergy       = EscapedEnergy;
+      event.NSMaterialEnergy    = NSMaterialEnergy;
+      event.PhysicsModuleType   = modules.Name(PhysicsModuleType);
+      event.PhysicsModuleEnergy = PhysicsModuleEnergy;
+    }
+
+    if (columns & kFlatHits) {
+      event.Hits.resize(static_cast<size_t>(nHits));
+      for (const auto& c : hitInt)    if (columns & c.group) c.Load(event.Hits);
+      for (const auto& c : hitFloat)  if (columns & c.group) c.Load(event.Hits);
+      for (const auto& c : hitDouble) if (columns & c.group) c.Load(event.Hits);
+
+      if (columns & kFlatHitPIDs) {
+        Int_t begin = 0;
+        const size_t n = std::min(hitPIDEnd.size(), event.Hits.size());
+        for (size_t k = 0; k < n; ++k) {
+          const Int_t end = hitPIDEnd[k];
+          event.Hits[k].PrimaryParticleIDs.assign(hitPIDs.begin() + begin, hitPIDs.begin() + end);
+          begin = end;
+        }
+      }
+    }
+
+    if (columns & kFlatInteractions) {
+      event.Interactions.resize(static_cast<size_t>(nInteractions));
+      for (const auto& c : iaInt)    c.Load(event.Interactions);
+      for (const auto& c : iaFloat)  c.Load(event.Interactions);
+      for (const auto& c : iaDouble) c.Load(event.Interactions);
+      const size_t n = std::min(iaType.size(), event.Interactions.size());
+      for (size_t k = 0; k < n; ++k) event.Interactions[k].Type = iaTypes.Name(iaType[k]);
+    }
+  }
+
+  // writer side: create all the branches
+  void Branch(TTree& tree)
+  {
+    tree.Branch("TriggerID",           &TriggerID,           "TriggerID/I");
+    tree.Branch("EventID",             &EventID,             "EventID/I");
+    tree.Branch("InitialTime",         &InitialTime,         "InitialTime/D");
+    tree.Branch("TotDepositedEnergy",  &TotDepositedEnergy,  "TotDepositedEnergy/F");
+    tree.Branch("EscapedEnergy",       &EscapedEnergy,       "EscapedEnergy/F");
+    tree.Branch("NSMaterialEnergy",    &NSMaterialEnergy,    "NSMaterialEnergy/F");
+    tree.Branch("PhysicsModuleType",   &PhysicsModuleType,   "PhysicsModuleType/I");
+    tree.Branch("PhysicsModuleEnergy", &PhysicsModuleEnergy, "PhysicsModuleEnergy/F");
+    tree.Branch("nHits",               &nHits,               "nHits/I");
+    tree.Branch("nInteractions",       &nInteractions,       "nInteractions/I");
+
+    for (auto& c : hitInt)    tree.Branch(c.name, &c.values);
+    for (auto& c : hitFloat)  tree.Branch(c.name, &c.values);
+    for (auto& c : hitDouble) tree.Branch(c.name, &c.values);
+    tree.Branch("Hit_PIDEnd", &hitPIDEnd);
+    tree.Branch("Hit_PIDs",   &hitPIDs);
+
+    tree.Branch("IA_Type", &iaType);
+    for (auto& c : iaInt)    tree.Branch(c.name, &c.values);
+    for (auto& c : iaFloat)  tree.Branch(c.name, &c.values);
+    for (auto& c : iaDouble) tree.Branch(c.name, &c.values);
+  }
+
+  // reader side: bind the branches of the given groups, collect them
+  // in branches; false if a column is missing
+  bool Attach(TTree& tree, unsigned columns, std::vector<TBranch*>& branches)
+  {
+    bool ok = true;
+    auto scalar = [&](const char* name, void* address) {
+      ok &= Bind(tree, name, address, branches);
+    };
+    auto vector = [&](const char* name, void* values) {
+      fAddresses.push_back(values); // ROOT keeps the address of the pointer
+      ok &= Bind(tree, name, &fAddresses.back(), branches);
+    };
+
+    scalar("nHits",         &nHits);
+    scalar("nInteractions", &nInteractions);
+
+    if (columns & kFlatEvent) {
+      scalar("TriggerID",           &TriggerID);
+      scalar("EventID",             &EventID);
+      scalar("InitialTime",         &InitialTime);
+      scalar("TotDepositedEnergy",  &TotDepositedEnergy);
+      scalar("EscapedEnergy",       &EscapedEnergy);
+      scalar("NSMaterialEnergy",    &NSMaterialEnergy);
+      scalar("PhysicsModuleType",   &PhysicsModuleType);
+      scalar("PhysicsModuleEnergy", &PhysicsModuleEnergy);
+    }
+
+    for (auto& c : hitInt)    if (columns & c.group) vector(c.name, &c.values);
+    for (auto& c : hitFloat)  if (columns & c.group) vector(c.name, &c.values);
+    for (auto& c : hitDouble) if (columns & c.group) vector(c.name, &c.values);
+    if (columns & kFlatHitPIDs) {
+      vector("Hit_PIDEnd", &hitPIDEnd);
+      vector("Hit_PIDs",   &hitPIDs);
+    }
+
+    if (columns & kFlatInteractions) {
+      vector("IA_Type", &iaType);
+      for (auto& c : iaInt)    vector(c.name, &c.values);
+      for (auto& c : iaFloat)  vector(c.name, &c.values);
+      for (auto& c : iaDouble) vector(c.name, &c.values);
+    }
+    return ok;
+  }
+
+ private:
+  static bool Bind(TTree& tree, const char* name, void* address, std::vector<TBranch*>& branches)
+  {
+    TBranch* branch = tree.GetBranch(name);
+    if (!branch) {
+      std::cerr << "ERROR: column '" << name << "' not found in " << tree.GetName() << std::endl;
+      return false;
+    }
+    tree.SetBranchAddress(name, address);
+    branches.push_back(branch);
+    return true;
+  }
+
+  Int_t    TriggerID = 0;
+  Int_t    EventID = 0;
+  Double_t InitialTime = 0;
+  Float_t  TotDepositedEnergy = 0;
+  Float_t  EscapedEnergy = 0;
+  Float_t  NSMaterialEnergy = 0;
+  Int_t    PhysicsModuleType = -1;
+  Float_t  PhysicsModuleEnergy = 0;
+  Int_t    nHits = 0;
+  Int_t    nInteractions = 0;
+
+  std::vector<FlatColumn<HitData, Int_t>>            hitInt;
+  std::vector<FlatColumn<HitData, Float_t>>          hitFloat;
+  std::vector<FlatColumn<HitData, Double_t>>         hitDouble;
+  std::vector<Int_t>                                 hitPIDEnd;
+  std::vector<Int_t>                                 hitPIDs;
+
+  std::vector<Int_t>                                 iaType;
+  std::vector<FlatColumn<InteractionData, Int_t>>    iaInt;
+  std::vector<FlatColumn<InteractionData, Float_t>>  iaFloat;
+  std::vector<FlatColumn<InteractionData, Double_t>> iaDouble;
+
+  std::deque<void*> fAddresses; // stable: SetBranchAddress keeps &element
+};
+
+// -------------------------------------------------------------------
+// Consumer that writes the EventsFlat tree (see EventConsumer.h)
+// -------------------------------------------------------------------
+class FlatTreeWriter : public EventConsumer {
+ public:
+  explicit FlatTreeWriter(const char* outputFile) : fOutputFile(outputFile) {}
+  // End() never reached (parse error, truncated input): no partial file
+  ~FlatTreeWriter() override
+  {
+    if (!fFile) return;
+    delete fFile;
+    gSystem->Unlink(fOutputFile.c_str());
+  }
+
+  void Begin(const RunInfo& runInfo) override
+  {
+    fFile = new TFile(fOutputFile.c_str(), "RECREATE");
+    if (fFile->IsZombie()) {
+      std::cerr << "Error: Could not create output file " << fOutputFile << std::endl;
+      delete fFile;
+      fFile = nullptr;
+      return;
+    }
+    fTree = new TTree("EventsFlat", "Parsed Simulation Events (columnar)");
+    fColumns.Branch(*fTree);
+    fTree->GetUserInfo()->Add(new RunInfo(runInfo));
+  }
+
+  void Consume(const EventData& event) override
+  {
+    if (!fTree) return;
+    fColumns.Store(event, fIATypes, fModules);
+    fTree->Fill();
+  }
+
+  void End() override
+  {
+    if (!fFile) return;
+    fTree->GetUserInfo()->Add(fIATypes.ToArray("IATypes"));
+    fTree->GetUserInfo()->Add(fModules.ToArray("PhysicsModuleTypes"));
+    fFile->cd();
+    fTree->Write();
+    std::cout << "Saved " << fTree->GetEntries() << " events (flat) to " << fOutputFile << std::endl;
+    fFile->Close();
+    delete fFile;
+    fFile = nullptr;
+    fTree = nullptr;
+  }
+
+ private:
+  std::string      fOutputFile;
+  TFile*           fFile = nullptr;
+  TTree*           fTree = nullptr;
+  FlatEventColumns fColumns;
+  FlatDictionary   fIATypes;
+  FlatDictionary   fModules;
+};
+
+// -------------------------------------------------------------------
+// Reads the requested column groups of an EventsFlat tree into an
+// EventData; only the branches of those groups are touched on disk
+// -------------------------------------------------------------------
+class FlatEventReader {
+ public:
+  FlatEventReader(TTree* tree, unsigned columns)
+    : fTree(tree), fColumns(columns)
+  {
+    if (!fTree) return;
+    fValid = fCols.Attach(*fTree, fColumns, fBranches);
+
+    TList* info = fTree->GetUserInfo();
+    fIATypes.FromArray(dynamic_cast<TObjArray*>(info->FindObject("IATypes")));
+    fModules.FromArray(dynamic_cast<TObjArray*>(info->FindObject("PhysicsModuleTypes")));
+    fRunInfo = dynamic_cast<RunInfo*>(info->FindObject("RunInfo"));
+  }
+
+  ~FlatEventReader() { if (fTree) fTree->ResetBranchAddresses(); }
+
+  bool            IsValid()    const { return fValid; }
+  Long64_t        GetEntries() const { return fTree ? fTree->GetEntries() : 0; }
+  const RunInfo*  GetRunInfo() const { return fRunInfo; }
+
+  bool GetEntry(Long64_t entry, EventData& event)
+  {
+    if (!fValid) return false;
+    for (TBranch* b : fBranches) {
+      if (b->GetEntry(entry) < 0) return false;
+    }
+    fCols.Load(event, fColumns, fIATypes, fModules);
+    return true;
+  }
+
+ private:
+  TTree*                fTree = nullptr;
+  unsigned              fColumns;
+  bool                  fValid = false;
+  FlatEventColumns      fCols;
+  std::vector<TBranch*> fBranches;
+  FlatDictionary        fIATypes;
+  FlatDictionary        fModules;
+  const RunInfo*        fRunInfo = nullptr;
+};
+
+inline bool IsFlatEventTree(TTree* tree)
+{
+  return tree && tree->GetBranch("nHits") && !tree->GetBranch("Event");
+}
+
+// "EventsFlat" if the file has it, otherwise the object tree "Events"
+inline TTree* GetEventTree(TFile* file)
+{
+  if (!file) return nullptr;
+  TTree* tree = dynamic_cast<TTree*>(file->Get("EventsFlat"));
+  if (!tree) tree = dynamic_cast<TTree*>(file->Get("Events"));
+  return tree;
+}
+
+// RunInfo of either layout (UserInfo or "RunInfo" branch, entry 0)
+inline bool GetEventTreeRunInfo(TTree* tree, RunInfo& runInfo)
+{
+  if (!tree) return false;
+  if (IsFlatEventTree(tree)) {
+    const RunInfo* info = dynamic_cast<RunInfo*>(tree->GetUserInfo()->FindObject("RunInfo"));
+    if (!info) return false;
+    runInfo = *info;
+    return true;
+  }
+  if (!tree->GetBranch("RunInfo")) return false;
+  RunInfo* info = nullptr;
+  tree->SetBranchAddress("RunInfo", &info);
+  tree->GetBranch("RunInfo")->GetEntry(0);
+  const bool ok = (info != nullptr);
+  if (ok) runInfo = *info;
+  tree->ResetBranchAddress(tree->GetBranch("RunInfo"));
+  delete info;
+  return ok;
+}
+
+// -------------------------------------------------------------------
+// Loop over the events of an "Events" or "EventsFlat" tree, entries
+// [first, last) (last < 0: up to the end): f(const EventData&) per
+// entry; with the flat layout only the given column groups are read.
+// Returns false on a read error.
+// -------------------------------------------------------------------
+template <class F>
+bool ForEachEventInTree(TTree* tree, unsigned columns, F&& f,
+                        Long64_t first = 0, Long64_t last = -1)
+{
+  if (!tree) return false;
+  const Long64_t nEntries = tree->GetEntries();
+  if (last < 0 || last > nEntries) last = nEntries;
+
+  if (IsFlatEventTree(tree)) {
+    FlatEventReader reader(tree, columns);
+    if (!reader.IsValid()) return false;
+    EventData event;
+    for (Long64_t i = first; i < last; ++i) {
+      if (!reader.GetEntry(i, event)) return false;
+      f(static_cast<const EventData&>(event));
+    }
+    return true;
+  }
+
+  EventData* event = nullptr;
+  tree->SetBranchAddress("Event", &event);
+  for (Long64_t i = first; i < last; ++i) {
+    tree->GetEntry(i);
+    if (event) f(static_cast<const EventData&>(*event));
+  }
+  tree->ResetBranchAddress(tree->GetBranch("Event"));
+  delete event;
+  return true;
+}
+
+// same, only for the given entries (in that order)
+template <class F>
+bool ForEachEventInTree(TTree* tree, unsigned columns, const std::vector<Long64_t>& entries, F&& f)
+{
+  if (!tree) return false;
+
+  if (IsFlatEventTree(tree)) {
+    FlatEventReader reader(tree, columns);
+    if (!reader.IsValid()) return false;
+    EventData event;
+    for (const Long64_t i : entries) {
+      if (!reader.GetEntry(i, event)) return false;
+      f(static_cast<const EventData&>(event));
+    }
+    return true;
+  }
+
+  EventData* event = nullptr;
+  tree->SetBranchAddress("Event", &event);
+  for (const Long64_t i : entries) {
+    tree->GetEntry(i);
+    if (event) f(static_cast<const EventData&>(*event));
+  }
+  tree->ResetBranchAddress(tree->GetBranch("Event"));
+  delete event;
+  return true;
+}
+
+#endif // FLATEVENTS_H
@@ -0,0 +1,172 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include "TNamed.h"
+#include "TCollection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+//--------------------------------------------------
+// Streaming quantile sketch (merging t-digest, k1 scale function).
+//
+// Keeps at most ~compression centroids, whatever the range and the
+// number of values: no binning, and the rank error shrinks towards the
+// tails (q(1-q)), which is where the 90/95/99% percentiles live.
+// Mergeable: shards of a multi-thread analysis with Merge(), and files
+// with hadd (Merge(TCollection*)).
+//--------------------------------------------------
+class QuantileSketch : public TNamed {
+ public:
+  QuantileSketch() = default;
+  QuantileSketch(const char* name, const char* title, Double_t compression = 200.)
+    : TNamed(name, title), fCompression(compression) {}
+  virtual ~QuantileSketch() = default;
+
+  void Fill(Double_t x, Double_t w = 1.)
+  {
+    if (!(w > 0.) || std::isnan(x)) return;
+    fBuffer.emplace_back(x, w);
+    if (fBuffer.size() >= BufferSize()) Compress();
+  }
+
+  void Merge(const QuantileSketch& other)
+  {
+    // gli estremi veri: i centroidi ne danno solo le medie
+    fMin = std::min(fMin, other.fMin);
+    fMax = std::max(fMax, other.fMax);
+    for (size_t i = 0; i < other.fMean.size(); ++i) {
+      fBuffer.emplace_back(other.fMean[i], other.fWeight[i]);
+    }
+    fBuffer.insert(fBuffer.end(), other.fBuffer.begin(), other.fBuffer.end());
+    Compress();
+  }
+
+  // hadd
+  Long64_t Merge(TCollection* list)
+  {
+    if (!list) return 0;
+    TIter next(list);
+    while (TObject* obj = next()) {
+      if (const QuantileSketch* other = dynamic_cast<const QuantileSketch*>(obj)) Merge(*other);
+    }
+    return static_cast<Long64_t>(GetCount());
+  }
+
+  // riduce il buffer nei centroidi: va chiamata prima di scrivere su file
+  void Compress()
+  {
+    if (fBuffer.empty()) return;
+
+    for (size_t i = 0; i < fMean.size(); ++i) fBuffer.emplace_back(fMean[i], fWeight[i]);
+    std::sort(fBuffer.begin(), fBuffer.end());
+
+    Double_t total = 0.;
+    for (const auto& c : fBuffer) total += c.second;
+
+    fMean.clear();
+    fWeight.clear();
+    fMin = std::min(fMin, fBuffer.front().first);
+    fMax = std::max(fMax, fBuffer.back().first);
+
+    Double_t soFar = 0.;
+    Double_t mean  = fBuffer.front().first;
+    Double_t w     = fBuffer.front().second;
+    Double_t limit = total * KInverse(K(0.) + 1.);
+    for (size_t i = 1; i < fBuffer.size(); ++i) {
+      const Double_t x  = fBuffer[i].first;
+      const Double_t wx = fBuffer[i].second;
+      if (soFar + w + wx <= limit) {
+        w    += wx;
+        mean += (x - mean) * wx / w;
+      } else {
+        fMean.push_back(mean);
+        fWeight.push_back(w);
+        soFar += w;
+        limit  = total * KInverse(K(soFar / total) + 1.);
+        mean   = x;
+        w      = wx;
+      }
+    }
+    fMean.push_back(mean);
+    fWeight.push_back(w);
+    fTotalWeight = total;
+
+    std::vector<std::pair<Double_t, Double_t>>().swap(fBuffer);
+  }
+
+  Double_t GetCount() const
+  {
+    Double_t n = fTotalWeight;
+    for (const auto& c : fBuffer) n += c.second;
+    return n;
+  }
+
+  Double_t GetMin() { Compress(); return fMean.empty() ? 0. : fMin; }
+  Double_t GetMax() { Compress(); return fMean.empty() ? 0. : fMax; }
+
+  // q in [0, 1]; interpolazione lineare fra i centri dei centroidi
+  Double_t Quantile(Double_t q)
+  {
+    Compress();
+    const size_t n = fMean.size();
+    if (n == 0) return 0.;
+    if (n == 1 || q <= 0.) return q <= 0. ? fMin : fMean[0];
+    if (q >= 1.) return fMax;
+
+    const Double_t index = q * fTotalWeight;
+
+    // prima meta' del primo centroide: fra il minimo e il suo centro
+    if (index < fWeight[0] / 2.) {
+      return fMin + (fMean[0] - fMin) * index / (fWeight[0] / 2.);
+    }
+
+    Double_t soFar = fWeight[0] / 2.;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      const Double_t dw = (fWeight[i] + fWeight[i + 1]) / 2.;
+      if (soFar + dw > index) {
+        return fMean[i] + (fMean[i + 1] - fMean[i]) * (index - soFar) / dw;
+      }
+      soFar += dw;
+    }
+
+    // ultima meta' dell'ultimo centroide: fino al massimo
+    const Double_t z = (index - soFar) / (fWeight[n - 1] / 2.);
+    return std::min(fMax, fMean[n - 1] + (fMax - fMean[n - 1]) * z);
+  }
+
+  void GetQuantiles(Int_t nprobSum, Double_t* q, const Double_t* probSum)
+  {
+    for (Int_t i = 0; i < nprobSum; ++i) q[i] = Quantile(probSum[i]);
+  }
+
+  Int_t GetNCentroids() const { return static_cast<Int_t>(fMean.size()); }
+
+ private:
+  size_t BufferSize() const { return static_cast<size_t>(5. * fCompression) + 1; }
+
+  // k1: k(q) = delta/(2 pi) asin(2q - 1)
+  Double_t K(Double_t q) const
+  {
+    return fCompression / (2. * M_PI) * std::asin(2. * q - 1.);
+  }
+  Double_t KInverse(Double_t k) const
+  {
+    if (k >= fCompression / 4.) return 1.;
+    return (std::sin(k * 2. * M_PI / fCompression) + 1.) / 2.;
+  }
+
+  Double_t              fCompression = 200.;
+  Double_t              fTotalWeight = 0.;
+  Double_t              fMin = HUGE_VAL;
+  Double_t              fMax = -HUGE_VAL;
+  std::vector<Double_t> fMean;      // centroidi, ordinati
+  std::vector<Double_t> fWeight;
+  std::vector<std::pair<Double_t, Double_t>> fBuffer; //! valori non ancora compressi
+
+  ClassDef(QuantileSketch, 1)
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,372 @@
+// SimDecompress.h
+#ifndef SIMDECOMPRESS_H
+#define SIMDECOMPRESS_H
+
+// ===================================================================
+// In-process streaming decompression for .sim.gz (and optionally
+// .sim.xz / .sim.zst) files.
+//
+// A SimDecoder turns the compressed file into raw bytes; the
+// SimDecompressStream runs it in its own thread and hands fixed-size
+// buffers to the parser through a bounded queue, so decompression and
+// parsing overlap and nothing is ever written to disk.
+//
+// zlib is always used; liblzma and libzstd are optional:
+//   gSystem->AddLinkedLibs("-lz");                   // always
+//   gSystem->AddIncludePath("-DSIM_HAVE_LZMA");      // + "-llzma"
+//   gSystem->AddIncludePath("-DSIM_HAVE_ZSTD");      // + "-lzstd"
+//   .L parse_and_fill_tree.C+
+// ===================================================================
+
+#include "SimParser.h"
+
+#include <zlib.h>
+#ifdef SIM_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef SIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -------------------------------------------------------------------
+// Decoder interface: Read() fills dst with up to n decompressed bytes,
+// returns 0 at end of stream and -1 on error.
+// -------------------------------------------------------------------
+class SimDecoder {
+ public:
+  virtual ~SimDecoder() = default;
+  virtual bool        Open(const char* path) = 0;
+  virtual long        Read(char* dst, size_t n) = 0;
+  virtual const char* Name() const = 0;
+};
+
+// gzip (also handles concatenated members and plain uncompressed input)
+class SimGzipDecoder : public SimDecoder {
+ public:
+  ~SimGzipDecoder() override { if (fFile) gzclose(fFile); }
+
+  bool Open(const char* path) override {
+    fFile = gzopen(path, "rb");
+    if (!fFile) return false;
+    gzbuffer(fFile, 1u << 20);
+    return true;
+  }
+
+  long Read(char* dst, size_t n) override {
+    const unsigned chunk = static_cast<unsigned>(std::min<size_t>(n, 1u << 30));
+    const int got = gzread(fFile, dst, chunk);
+    if (got <= 0) {
+      // a truncated file ends with got == 0 and Z_BUF_ERROR
+      int errnum = Z_OK;
+      const char* msg = gzerror(fFile, &errnum);
+      if (got < 0 || (errnum != Z_OK && errnum != Z_STREAM_END)) {
+        std::cerr << "ERROR: gzread failed: " << msg << std::endl;
+        return -1;
+      }
+    }
+    return got;
+  }
+
+  const char* Name() const override { return "zlib"; }
+
+ private:
+  gzFile fFile = nullptr;
+};
+
+#ifdef SIM_HAVE_LZMA
+// xz / lzma
+class SimXzDecoder : public SimDecoder {
+ public:
+  SimXzDecoder() : fIn(1u << 20) {}
+  ~SimXzDecoder() override {
+    lzma_end(&fStream);
+    if (fFile) std::fclose(fFile);
+  }
+
+  bool Open(const char* path) override {
+    fFile = std::fopen(path, "rb");
+    if (!fFile) return false;
+    return lzma_stream_decoder(&fStream, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+  }
+
+  long Read(char* dst, size_t n) override {
+    fStream.next_out  = reinterpret_cast<uint8_t*>(dst);
+    fStream.avail_out = n;
+    while (fStream.avail_out > 0 && !fFinished) {
+      lzma_action action = LZMA_RUN;
+      if (fStream.avail_in == 0) {
+        const size_t got = std::fread(fIn.data(), 1, fIn.size(), fFile);
+        fStream.next_in  = fIn.data();
+        fStream.avail_in = got;
+        if (got == 0) action = LZMA_FINISH;
+      }
+      const lzma_ret ret = lzma_code(&fStream, action);
+      if (ret == LZMA_STREAM_END) { fFinished = true; break; }
+      if (ret != LZMA_OK) {
+        std::cerr << "ERROR: xz decoder failed with code " << ret << std::endl;
+        return -1;
+      }
+    }
+    return static_cast<long>(n - fStream.avail_out);
+  }
+
+  const char* Name() const override { return "xz"; }
+
+ private:
+  FILE*                fFile = nullptr;
+  lzma_stream          fStream = LZMA_STREAM_INIT;
+  std::vector<uint8_t> fIn;
+  bool                 fFinished = false;
+};
+#endif
+
+#ifdef SIM_HAVE_ZSTD
+// zstd
+class SimZstdDecoder : public SimDecoder {
+ public:
+  SimZstdDecoder() : fIn(ZSTD_DStreamInSize()) {}
+  ~SimZstdDecoder() override {
+    if (fStream) ZSTD_freeDStream(fStream);
+    if (fFile) std::fclose(fFile);
+  }
+
+  bool Open(const char* path) override {
+    fFile = std::fopen(path, "rb");
+    if (!fFile) return false;
+    fStream = ZSTD_createDStream();
+    return fStream && !ZSTD_isError(ZSTD_initDStream(fStream));
+  }
+
+  long Read(char* dst, size_t n) override {
+    ZSTD_outBuffer out = { dst, n, 0 };
+    while (out.pos < out.size) {
+      if (fInput.pos == fInput.size && !fEof) {
+        const size_t got = std::fread(fIn.data(), 1, fIn.size(), fFile);
+        if (got == 0) {
+          if (std::ferror(fFile)) {
+            std::cerr << "ERROR: zstd input read failed" << std::endl;
+            return -1;
+          }
+          fEof = true;
+        }
+        fInput = { fIn.data(), got, 0 };
+      }
+      // at EOF: empty input, drains what zstd still holds
+      const size_t before = out.pos;
+      const size_t ret = ZSTD_decompressStream(fStream, &out, &fInput);
+      if (ZSTD_isError(ret)) {
+        std::cerr << "ERROR: zstd decoder failed: " << ZSTD_getErrorName(ret) << std::endl;
+        return -1;
+      }
+      fLastRet = ret;
+      if (fEof && out.pos == before) {
+        // nothing more to flush: a nonzero hint means the last frame is incomplete
+        if (fLastRet != 0) {
+          std::cerr << "ERROR: zstd stream is truncated" << std::endl;
+          return -1;
+        }
+        break;
+      }
+    }
+    return static_cast<long>(out.pos);
+  }
+
+  const char* Name() const override { return "zstd"; }
+
+ private:
+  FILE*             fFile = nullptr;
+  ZSTD_DStream*     fStream = nullptr;
+  std::vector<char> fIn;
+  ZSTD_inBuffer     fInput = { nullptr, 0, 0 };
+  size_t            fLastRet = 0;   // last ZSTD_decompressStream hint, 0 = frame complete
+  bool              fEof = false;
+};
+#endif
+
+// -------------------------------------------------------------------
+// Pick a decoder from the file extension (.gz, .xz, .zst)
+// -------------------------------------------------------------------
+inline std::unique_ptr<SimDecoder> SimMakeDecoder(const std::string& path)
+{
+  auto endsWith = [&path](const char* ext) {
+    const size_t n = std::char_traits<char>::length(ext);
+    return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+  };
+
+  if (endsWith(".xz")) {
+#ifdef SIM_HAVE_LZMA
+    return std::unique_ptr<SimDecoder>(new SimXzDecoder());
+#else
+    std::cerr << "ERROR: .xz input needs SIM_HAVE_LZMA (liblzma)" << std::endl;
+    return nullptr;
+#endif
+  }
+  if (endsWith(".zst")) {
+#ifdef SIM_HAVE_ZSTD
+    return std::unique_ptr<SimDecoder>(new SimZstdDecoder());
+#else
+    std::cerr << "ERROR: .zst input needs SIM_HAVE_ZSTD (libzstd)" << std::endl;
+    return nullptr;
+#endif
+  }
+  return std::unique_ptr<SimDecoder>(new SimGzipDecoder());
+}
+
+// Strip the compression extension: "foo.sim.gz" -> "foo.sim"
+inline std::string SimStripCompressionExt(const std::string& path)
+{
+  for (const char* ext : { ".gz", ".xz", ".zst" }) {
+    const size_t pos = path.rfind(ext);
+    if (pos != std::string::npos && pos + std::char_traits<char>::length(ext) == path.size()) {
+      return path.substr(0, pos);
+    }
+  }
+  return path;
+}
+
+// ===================================================================
+// Decompressor thread + bounded queue of fixed-size buffers.
+// The producer thread only touches the decoder (no ROOT calls).
+// ===================================================================
+class SimDecompressStream : public SimByteSource {
+ public:
+  SimDecompressStream(std::unique_ptr<SimDecoder> decoder,
+                      size_t bufferSize = (size_t(4) << 20),
+                      size_t queueDepth = 4)
+    : fDecoder(std::move(decoder)), fBufferSize(bufferSize)
+  {
+    for (size_t i = 0; i < std::max<size_t>(queueDepth, 2); ++i) {
+      fFree.emplace_back(new Block());
+    }
+  }
+
+  ~SimDecompressStream() override { Stop(); }
+
+  bool Open(const char* path)
+  {
+    if (!fDecoder || !fDecoder->Open(path)) {
+      std::cerr << "ERROR: could not open compressed input: " << path << std::endl;
+      return false;
+    }
+    fThread = std::thread(&SimDecompressStream::Produce, this);
+    fOpened = true;
+    return true;
+  }
+
+  // true if the decoder reported an error (the input is then truncated)
+  bool Failed() const override { return fFailed; }
+
+  size_t Read(char* dst, size_t n) override
+  {
+    size_t copied = 0;
+    while (copied < n) {
+      if (!fCurrent || fPos == fCurrent->size) {
+        if (!NextBlock()) break;
+        continue;
+      }
+      const size_t len = std::min(n - copied, fCurrent->size - fPos);
+      std::memcpy(dst + copied, fCurrent->data.data() + fPos, len);
+      fPos   += len;
+      copied += len;
+    }
+    return copied;
+  }
+
+ private:
+  struct Block {
+    std::vector<char> data;
+    size_t            size = 0;
+    bool              last = false;
+  };
+
+  // consumer side: recycle the drained block, wait for the next one
+  bool NextBlock()
+  {
+    if (!fOpened || fFinished) return false;
+    std::unique_lock<std::mutex> lock(fMutex);
+    if (fCurrent) {
+      fFinished = fCurrent->last;
+      fFree.push_back(std::move(fCurrent));
+      fCanProduce.notify_one();
+      if (fFinished) return false;
+    }
+    fCanConsume.wait(lock, [this] { return !fFull.empty(); });
+    fCurrent = std::move(fFull.front());
+    fFull.pop_front();
+    fPos = 0;
+    return true;
+  }
+
+  void Produce()
+  {
+    while (true) {
+      std::unique_ptr<Block> block;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fCanProduce.wait(lock, [this] { return fStop || !fFree.empty(); });
+        if (fStop) return;
+        block = std::move(fFree.front());
+        fFree.pop_front();
+      }
+
+      block->data.resize(fBufferSize);
+      block->size = 0;
+      block->last = false;
+      while (block->size < fBufferSize) {
+        const long got = fDecoder->Read(block->data.data() + block->size, fBufferSize - block->size);
+        if (got < 0) { fFailed = true; }
+        if (got <= 0) { block->last = true; break; }
+        block->size += static_cast<size_t>(got);
+      }
+
+      const bool last = block->last;
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fFull.push_back(std::move(block));
+      }
+      fCanConsume.notify_one();
+      if (last) return;
+    }
+  }
+
+  // the parser may stop early (EN): release the producer and join it
+  void Stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+    }
+    fCanProduce.notify_all();
+    if (fThread.joinable()) fThread.join();
+  }
+
+  std::unique_ptr<SimDecoder> fDecoder;
+  const size_t                fBufferSize;
+
+  std::mutex                          fMutex;
+  std::condition_variable             fCanProduce;
+  std::condition_variable             fCanConsume;
+  std::deque<std::unique_ptr<Block>>  fFree;
+  std::deque<std::unique_ptr<Block>>  fFull;
+  std::unique_ptr<Block>              fCurrent;
+  size_t                              fPos = 0;
+  bool                                fOpened = false;
+  bool                                fFinished = false;
+  bool                                fStop = false;
+  std::atomic<bool>                   fFailed{false};
+  std::thread                         fThread;
+};
+
+#endif // SIMDECOMPRESS_H
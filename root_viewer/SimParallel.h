@@ -0,0 +1,281 @@
+// SimParallel.h
+#ifndef SIMPARALLEL_H
+#define SIMPARALLEL_H
+
+// ===================================================================
+// Multi-threaded parsing of a single, uncompressed .sim file.
+//
+// The file is memory-mapped; the run header (everything up to TB) is
+// parsed once on the calling thread, then the event section is cut
+// into byte ranges that start on an SE line. Worker threads turn each
+// range into a batch of EventData, and the batches are handed to the
+// caller's onEvent() on the calling thread in the original file order,
+// so a TTree can be filled exactly as the serial parser would.
+//
+// At most (nThreads + 2) chunks are in flight: memory stays bounded
+// regardless of the file size.
+//
+// Limitation: run-level tags that appear after TB are not propagated
+// to RunInfo (the serial parser would pick them up); MEGAlib writes
+// them in the header only.
+// ===================================================================
+
+#include "SimParser.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -------------------------------------------------------------------
+// Read-only memory map of a whole file
+// -------------------------------------------------------------------
+class SimMappedFile {
+ public:
+  SimMappedFile() = default;
+  SimMappedFile(const SimMappedFile&) = delete;
+  SimMappedFile& operator=(const SimMappedFile&) = delete;
+  ~SimMappedFile() { Close(); }
+
+  bool Open(const char* path)
+  {
+    Close();
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+    fSize = static_cast<size_t>(st.st_size);
+    if (fSize > 0) {
+      void* addr = ::mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) { ::close(fd); fSize = 0; return false; }
+      ::madvise(addr, fSize, MADV_SEQUENTIAL);
+      fData = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+    return true;
+  }
+
+  void Close()
+  {
+    if (fData) ::munmap(const_cast<char*>(fData), fSize);
+    fData = nullptr;
+    fSize = 0;
+  }
+
+  const char* Begin() const { return fData; }
+  const char* End()   const { return fData + fSize; }
+  size_t      Size()  const { return fSize; }
+
+ private:
+  const char* fData = nullptr;
+  size_t      fSize = 0;
+};
+
+// Next line of an in-memory buffer (same splitting as SimLineReader)
+inline bool SimNextLine(const char*& pos, const char* end, const char*& lb, const char*& le)
+{
+  if (pos >= end) return false;
+  lb = pos;
+  const char* nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+  le  = nl ? nl : end;
+  pos = nl ? nl + 1 : end;
+  return true;
+}
+
+// First line starting at or after pos whose tag is SE (or end)
+inline const char* SimFindEventStart(const char* pos, const char* begin, const char* end)
+{
+  if (pos > begin && pos < end && pos[-1] != '\n') {
+    const char* nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    pos = nl ? nl + 1 : end;
+  }
+  const char* lb = nullptr;
+  const char* le = nullptr;
+  const char* next = pos;
+  while (SimNextLine(next, end, lb, le)) {
+    SimLineCursor c(lb, le);
+    const char* tb = lb;
+    const char* te = lb;
+    if (c.ReadToken(tb, te) && SimTagIs(tb, te, "SE")) return lb;
+  }
+  return end;
+}
+
+// Hand the content of src over to dst without copying the vectors
+inline void SimTakeEvent(EventData& dst, EventData& src)
+{
+  dst.TriggerID           = src.TriggerID;
+  dst.EventID             = src.EventID;
+  dst.InitialTime         = src.InitialTime;
+  dst.TotDepositedEnergy  = src.TotDepositedEnergy;
+  dst.EscapedEnergy       = src.EscapedEnergy;
+  dst.NSMaterialEnergy    = src.NSMaterialEnergy;
+  dst.PhysicsModuleType   = src.PhysicsModuleType;
+  dst.PhysicsModuleEnergy = src.PhysicsModuleEnergy;
+  dst.Interactions.swap(src.Interactions);
+  dst.Hits.swap(src.Hits);
+}
+
+inline int SimResolveThreads(int nThreads)
+{
+  if (nThreads > 0) return nThreads;
+  const unsigned hw = std::thread::hardware_concurrency();
+  return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+// -------------------------------------------------------------------
+// Parse [begin, end) with nThreads workers; onEvent(EventData&) is
+// called on this thread, in file order. The argument may be moved
+// from (e.g. with SimTakeEvent). onHeader() runs once, after the run
+// header, before the first event. Returns false if no TB was found.
+// -------------------------------------------------------------------
+template <class OnHeader, class OnEvent>
+bool SimParseParallel(const char* begin, const char* end,
+                      RunInfo& runInfo, int nThreads,
+                      OnHeader&& onHeader, OnEvent&& onEvent,
+                      size_t chunkBytes = (size_t(4) << 20))
+{
+  nThreads = SimResolveThreads(nThreads);
+
+  // ---- Run header: serial, up to and including TB ----
+  EventData      scratch;
+  SimEventParser header(runInfo, scratch);
+  const char* body = begin;
+  const char* lb = nullptr;
+  const char* le = nullptr;
+  while (!header.Started() && SimNextLine(body, end, lb, le)) {
+    header.ParseLine(lb, le, [](EventData&) {});
+  }
+  if (!header.Started()) {
+    std::cerr << "WARNING: no TB line found, no events to parse." << std::endl;
+    return false;
+  }
+  onHeader();
+
+  // ---- Chunk boundaries on SE lines ----
+  std::vector<const char*> cuts(1, body);
+  while (static_cast<size_t>(end - cuts.back()) > chunkBytes) {
+    const char* cut = SimFindEventStart(cuts.back() + chunkBytes, begin, end);
+    if (cut >= end) break;
+    cuts.push_back(cut);
+  }
+  cuts.push_back(end);
+  const size_t nChunks = cuts.size() - 1;
+
+  // events[0..count) are valid; delivered chunks are recycled, so the
+  // event vectors (swapped back by SimTakeEvent) keep their capacity
+  struct Chunk {
+    std::deque<EventData>  events;
+    size_t                 count  = 0;
+    bool                   sawEnd = false;
+  };
+
+  const size_t window = static_cast<size_t>(nThreads) + 2;
+  std::vector<std::unique_ptr<Chunk>> results(nChunks);
+  std::vector<std::unique_ptr<Chunk>> spare;
+  std::mutex              mutex;
+  std::condition_variable chunkReady;
+  std::condition_variable slotFree;
+  size_t                  delivered = 0;
+  bool                    stop = false;
+  std::atomic<size_t>     next{0};
+
+  auto worker = [&]() {
+    while (true) {
+      const size_t i = next.fetch_add(1);
+      if (i >= nChunks) return;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFree.wait(lock, [&] { return stop || i < delivered + window; });
+        if (stop) return;
+      }
+
+      std::unique_ptr<Chunk> chunk;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare.empty()) { chunk = std::move(spare.back()); spare.pop_back(); }
+      }
+      if (!chunk) chunk.reset(new Chunk());
+      chunk->count  = 0;
+      chunk->sawEnd = false;
+
+      RunInfo        localRun(runInfo);
+      EventData      current;
+      SimEventParser parser(localRun, current, true);
+      auto push = [&chunk](EventData& ev) {
+        if (chunk->count == chunk->events.size()) chunk->events.emplace_back();
+        SimTakeEvent(chunk->events[chunk->count++], ev);
+      };
+
+      const char* pos = cuts[i];
+      const char* cb  = nullptr;
+      const char* ce  = nullptr;
+      while (SimNextLine(pos, cuts[i + 1], cb, ce)) {
+        if (!parser.ParseLine(cb, ce, push)) { chunk->sawEnd = true; break; }
+      }
+      // the next chunk starts with SE, which would have stored this event
+      // (an unterminated last event is dropped, as in the serial parser)
+      if (!chunk->sawEnd && i + 1 < nChunks && current.TriggerID != 0) {
+        push(current);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[i] = std::move(chunk);
+      }
+      chunkReady.notify_all();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  const int nWorkers = static_cast<int>(std::min<size_t>(nThreads, nChunks));
+  for (int t = 0; t < nWorkers; ++t) pool.emplace_back(worker);
+
+  // ---- Ordered merge on the calling thread ----
+  for (size_t i = 0; i < nChunks; ++i) {
+    std::unique_ptr<Chunk> chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      chunkReady.wait(lock, [&] { return results[i] != nullptr; });
+      chunk = std::move(results[i]);
+    }
+    for (size_t k = 0; k < chunk->count; ++k) onEvent(chunk->events[k]);
+    const bool sawEnd = chunk->sawEnd;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      delivered = i + 1;
+      if (sawEnd) stop = true;
+      spare.push_back(std::move(chunk));
+    }
+    slotFree.notify_all();
+    if (sawEnd) break;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  slotFree.notify_all();
+  for (auto& t : pool) t.join();
+  return true;
+}
+
+template <class OnEvent>
+bool SimParseParallel(const char* begin, const char* end,
+                      RunInfo& runInfo, int nThreads, OnEvent&& onEvent,
+                      size_t chunkBytes = (size_t(4) << 20))
+{
+  return SimParseParallel(begin, end, runInfo, nThreads, [] {},
+                          std::forward<OnEvent>(onEvent), chunkBytes);
+}
+
+#endif // SIMPARALLEL_H
@@ -0,0 +1,453 @@
+// SimParser.h
+#ifndef SIMPARSER_H
+#define SIMPARSER_H
+
+#include "EventData.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// ===================================================================
+// Zero-copy tokenizer for the MEGAlib .sim text format.
+//
+// SimLineCursor walks a [begin, end) slice of a line in place and
+// reproduces the semantics of the std::stringstream extractions the
+// old parser used (operator>> on strings/ints/floats, getline on ';'),
+// so the values written into EventData are bit-identical:
+//   - whitespace is skipped before every extraction;
+//   - an extraction at end of input leaves the target untouched;
+//   - a malformed number writes 0, an out-of-range one is clamped;
+//   - after the first failure every further extraction is a no-op.
+// Numbers are converted with std::from_chars (correctly rounded, like
+// the strtof/strtod calls behind libstdc++'s num_get).
+// ===================================================================
+struct SimLineCursor {
+  const char* p;
+  const char* end;
+  bool        fail;
+
+  SimLineCursor(const char* b, const char* e) : p(b), end(e), fail(false) {}
+
+  static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+  }
+
+  // Same role as the istream sentry: skip blanks, fail at end of input
+  bool Sentry() {
+    if (fail) return false;
+    while (p < end && IsSpace(*p)) ++p;
+    if (p == end) { fail = true; return false; }
+    return true;
+  }
+
+  // operator>>(std::string&)
+  bool ReadToken(const char*& tb, const char*& te) {
+    if (!Sentry()) return false;
+    tb = p;
+    while (p < end && !IsSpace(*p)) ++p;
+    te = p;
+    return true;
+  }
+
+  // std::getline(ss, segment, delim)
+  bool ReadSegment(const char*& sb, const char*& se, char delim = ';') {
+    if (fail) return false;
+    if (p == end) { fail = true; return false; }
+    sb = p;
+    const char* d = static_cast<const char*>(std::memchr(p, delim, end - p));
+    if (d) { se = d; p = d + 1; }
+    else   { se = end; p = end; }
+    return true;
+  }
+
+  // operator>>(Int_t&)
+  bool ReadInt(Int_t& v) {
+    if (!Sentry()) return false;
+    const char* b = p;
+    if (*p == '+' || *p == '-') ++p;
+    const char* digits = p;
+    while (p < end && *p >= '0' && *p <= '9') ++p;
+    if (p == digits) { v = 0; fail = true; return false; }
+
+    long long value = 0;
+    const char* first = (*b == '+') ? b + 1 : b;
+    const auto res = std::from_chars(first, p, value);
+    if (res.ec == std::errc::result_out_of_range) {
+      value = (*b == '-') ? std::numeric_limits<long long>::min()
+                          : std::numeric_limits<long long>::max();
+    }
+    if (value < std::numeric_limits<Int_t>::min()) {
+      v = std::numeric_limits<Int_t>::min(); fail = true; return false;
+    }
+    if (value > std::numeric_limits<Int_t>::max()) {
+      v = std::numeric_limits<Int_t>::max(); fail = true; return false;
+    }
+    v = static_cast<Int_t>(value);
+    return true;
+  }
+
+  // operator>>(Float_t&) / operator>>(Double_t&)
+  template <class T>
+  bool ReadReal(T& v) {
+    if (!Sentry()) return false;
+
+    // Collect the characters num_get would accept for a float
+    const char* b = p;
+    bool mantissa = false, dot = false, sci = false;
+    if (*p == '+' || *p == '-') ++p;
+    while (p < end) {
+      const char c = *p;
+      if (c >= '0' && c <= '9') {
+        mantissa = true;
+      } else if (c == '.' && !dot && !sci) {
+        dot = true;
+      } else if ((c == 'e' || c == 'E') && !sci && mantissa) {
+        sci = true;
+        if (p + 1 < end && (p[1] == '+' || p[1] == '-')) ++p;
+      } else {
+        break;
+      }
+      ++p;
+    }
+
+    const char* first = (*b == '+') ? b + 1 : b;
+    const auto res = std::from_chars(first, p, v);
+    if (res.ec == std::errc::result_out_of_range && res.ptr == p) {
+      // Rare path: let strtod/strtof decide (denormals, overflow clamp)
+      const std::string tok(b, p);
+      char* stop = nullptr;
+      const T r = ConvertFallback(tok.c_str(), &stop, v);
+      if (r == std::numeric_limits<T>::infinity()) {
+        v = std::numeric_limits<T>::max(); fail = true; return false;
+      }
+      if (r == -std::numeric_limits<T>::infinity()) {
+        v = -std::numeric_limits<T>::max(); fail = true; return false;
+      }
+      v = r;
+      return true;
+    }
+    if (res.ec != std::errc() || res.ptr != p) { v = 0; fail = true; return false; }
+    return true;
+  }
+
+ private:
+  static Float_t  ConvertFallback(const char* s, char** stop, Float_t)  { return std::strtof(s, stop); }
+  static Double_t ConvertFallback(const char* s, char** stop, Double_t) { return std::strtod(s, stop); }
+};
+
+// Field extraction from a ';'-separated segment: stringstream(segment) >> v
+inline void SimParseSegment(const char* b, const char* e, Int_t& v)    { SimLineCursor(b, e).ReadInt(v); }
+inline void SimParseSegment(const char* b, const char* e, Float_t& v)  { SimLineCursor(b, e).ReadReal(v); }
+inline void SimParseSegment(const char* b, const char* e, Double_t& v) { SimLineCursor(b, e).ReadReal(v); }
+
+// Next ';' field of the cursor into v; false when the line has no more fields
+template <class T>
+inline bool SimNextField(SimLineCursor& c, T& v)
+{
+  const char* sb = nullptr;
+  const char* se = nullptr;
+  if (!c.ReadSegment(sb, se, ';')) return false;
+  SimParseSegment(sb, se, v);
+  return true;
+}
+
+template <size_t N>
+inline bool SimTagIs(const char* b, const char* e, const char (&lit)[N])
+{
+  return static_cast<size_t>(e - b) == N - 1 && std::memcmp(b, lit, N - 1) == 0;
+}
+
+inline void SimAssign(TString& dst, const char* b, const char* e)
+{
+  dst.Clear();
+  dst.Append(b, static_cast<Ssiz_t>(e - b));
+}
+
+// ===================================================================
+// Byte sources for the line reader: a plain std::istream, or any
+// producer of raw bytes (e.g. SimDecompressStream in SimDecompress.h).
+// Read() returns the number of bytes copied into dst, 0 at end of input.
+// ===================================================================
+class SimByteSource {
+ public:
+  virtual ~SimByteSource() = default;
+  virtual size_t Read(char* dst, size_t n) = 0;
+  // true if the input could not be read to the end (read / decoder error)
+  virtual bool Failed() const { return false; }
+};
+
+class SimIstreamSource : public SimByteSource {
+ public:
+  explicit SimIstreamSource(std::istream& input) : fInput(input) {}
+
+  size_t Read(char* dst, size_t n) override {
+    fInput.read(dst, static_cast<std::streamsize>(n));
+    const std::streamsize got = fInput.gcount();
+    return got > 0 ? static_cast<size_t>(got) : 0;
+  }
+
+  bool Failed() const override { return fInput.bad(); }
+
+ private:
+  std::istream& fInput;
+};
+
+// ===================================================================
+// Large-block line reader: pulls the input in multi-MB blocks and
+// hands out [begin, end) views of each line, without the trailing
+// '\n' (same line splitting as std::getline). Views stay valid until
+// the next call to NextLine.
+// ===================================================================
+class SimLineReader {
+ public:
+  explicit SimLineReader(SimByteSource& source, size_t blockSize = (size_t(4) << 20))
+    : fSource(source), fBuffer(blockSize), fBegin(0), fEnd(0), fEof(false) {}
+
+  bool NextLine(const char*& b, const char*& e) {
+    while (true) {
+      const char* base = fBuffer.data();
+      const char* nl = static_cast<const char*>(
+        std::memchr(base + fBegin, '\n', fEnd - fBegin));
+      if (nl) {
+        b = base + fBegin;
+        e = nl;
+        fBegin = (nl - base) + 1;
+        return true;
+      }
+      if (fEof) {
+        if (fBegin == fEnd) return false;
+        // last line without trailing newline
+        b = base + fBegin;
+        e = base + fEnd;
+        fBegin = fEnd;
+        return true;
+      }
+      Refill();
+    }
+  }
+
+ private:
+  void Refill() {
+    // keep the partial line, make room for the next block
+    if (fBegin > 0) {
+      std::memmove(fBuffer.data(), fBuffer.data() + fBegin, fEnd - fBegin);
+      fEnd  -= fBegin;
+      fBegin = 0;
+    }
+    if (fEnd == fBuffer.size()) {
+      fBuffer.resize(fBuffer.size() * 2);
+    }
+    const size_t n = fSource.Read(fBuffer.data() + fEnd, fBuffer.size() - fEnd);
+    if (n == 0) { fEof = true; return; }
+    fEnd += n;
+  }
+
+  SimByteSource&    fSource;
+  std::vector<char> fBuffer;
+  size_t            fBegin;
+  size_t            fEnd;
+  bool              fEof;
+};
+
+// ===================================================================
+// Event-level state machine: consumes one line at a time, fills
+// runInfo/event in place and calls onEvent() whenever an event block
+// is complete (at the next SE or at EN). The Interactions/Hits
+// vectors and the PrimaryParticleIDs buffers are recycled across
+// events, so the steady state does not allocate.
+// ===================================================================
+class SimEventParser {
+ public:
+  // started = true skips the run header (used for chunks after TB)
+  SimEventParser(RunInfo& runInfo, EventData& event, bool started = false)
+    : fRunInfo(runInfo), fEvent(event), fStarted(started), fDone(false) {}
+
+  bool Started() const { return fStarted; }
+  bool Done()    const { return fDone; }
+
+  // Returns false once EN has been seen (nothing more to parse)
+  template <class OnEvent>
+  bool ParseLine(const char* lb, const char* le, OnEvent&& onEvent)
+  {
+    SimLineCursor c(lb, le);
+    const char* tb = lb;
+    const char* te = lb;
+    c.ReadToken(tb, te);
+
+    // ---- Run-level info (before TB / events) ----
+    if (SimTagIs(tb, te, "SimulationStartAreaFarField")) {
+      c.ReadReal(fRunInfo.SimStartAreaFarField);
+      return true;
+    } else if (SimTagIs(tb, te, "BeamType")) {
+      const char* sb; const char* se;
+      if (c.ReadToken(sb, se)) {
+        SimAssign(fRunInfo.BeamType, sb, se);
+        if (c.ReadReal(fRunInfo.BeamTheta)) c.ReadReal(fRunInfo.BeamPhi);
+      }
+      return true;
+    } else if (SimTagIs(tb, te, "SpectralType")) {
+      const char* sb; const char* se;
+      if (c.ReadToken(sb, se)) {
+        SimAssign(fRunInfo.SpectralType, sb, se);
+        c.ReadReal(fRunInfo.SpectralEnergy);
+      }
+      return true;
+    }
+
+    // "TB" marks the beginning of the event block
+    if (SimTagIs(tb, te, "TB")) {
+      fStarted = true;
+      std::cout << fRunInfo.SimStartAreaFarField << "   "
+                << fRunInfo.BeamType            << "   "
+                << fRunInfo.BeamTheta           << "   "
+                << fRunInfo.BeamPhi             << "   "
+                << fRunInfo.SpectralType        << "   "
+                << fRunInfo.SpectralEnergy      << std::endl;
+      return true;
+    } else if (!fStarted) {
+      return true;
+    }
+
+    if (te - tb == 2) {
+      // ---- End of simulation ----
+      if (SimTagIs(tb, te, "EN")) {
+        if (fEvent.TriggerID != 0) onEvent(fEvent);
+        fDone = true;
+        return false;
+      }
+      // ---- Event-level tags ----
+      if (SimTagIs(tb, te, "SE")) {
+        if (fEvent.TriggerID != 0) onEvent(fEvent);
+        ResetEvent();
+      } else if (SimTagIs(tb, te, "ID")) {
+        if (c.ReadInt(fEvent.TriggerID)) c.ReadInt(fEvent.EventID);
+      } else if (SimTagIs(tb, te, "TI")) {
+        c.ReadReal(fEvent.InitialTime);
+      } else if (SimTagIs(tb, te, "ED")) {
+        c.ReadReal(fEvent.TotDepositedEnergy);
+      } else if (SimTagIs(tb, te, "EC")) {
+        c.ReadReal(fEvent.EscapedEnergy);
+      } else if (SimTagIs(tb, te, "NS")) {
+        c.ReadReal(fEvent.NSMaterialEnergy);
+      } else if (SimTagIs(tb, te, "PM")) {
+        const char* sb = lb; const char* se = lb;
+        c.ReadToken(sb, se);
+        SimAssign(fEvent.PhysicsModuleType, sb, se);
+        Float_t energy_val = 0;
+        c.ReadReal(energy_val);
+        fEvent.PhysicsModuleEnergy = energy_val;
+      } else if (SimTagIs(tb, te, "IA")) {
+        ParseInteraction(c);
+      }
+    } else if (SimTagIs(tb, te, "HTsim")) {
+      ParseHit(c);
+    }
+    return true;
+  }
+
+ private:
+  void ResetEvent()
+  {
+    fEvent.TriggerID           = 0;
+    fEvent.EventID             = 0;
+    fEvent.InitialTime         = 0.0;
+    fEvent.TotDepositedEnergy  = 0.0;
+    fEvent.EscapedEnergy       = 0.0;
+    fEvent.NSMaterialEnergy    = 0.0;
+    fEvent.PhysicsModuleType.Clear();
+    fEvent.PhysicsModuleEnergy = 0.0;
+
+    fEvent.Interactions.clear();
+    for (auto& hit : fEvent.Hits) {
+      fIDPool.push_back(std::move(hit.PrimaryParticleIDs));
+    }
+    fEvent.Hits.clear();
+  }
+
+  void ParseInteraction(SimLineCursor& c)
+  {
+    const char* sb = nullptr;
+    const char* se = nullptr;
+    const bool hasType = c.ReadToken(sb, se);
+
+    fEvent.Interactions.emplace_back();
+    InteractionData& ia = fEvent.Interactions.back();
+    if (hasType) SimAssign(ia.Type, sb, se);
+
+    const bool ok =
+      SimNextField(c, ia.Index)                &&
+      SimNextField(c, ia.ParentInteractionID)  &&
+      SimNextField(c, ia.DetectorID)           &&
+      SimNextField(c, ia.Time)                 &&
+      SimNextField(c, ia.X)                    &&
+      SimNextField(c, ia.Y)                    &&
+      SimNextField(c, ia.Z)                    &&
+      SimNextField(c, ia.MotherParticleCode)   &&
+      SimNextField(c, ia.Px_in)                &&
+      SimNextField(c, ia.Py_in)                &&
+      SimNextField(c, ia.Pz_in)                &&
+      SimNextField(c, ia.Dx_in)                &&
+      SimNextField(c, ia.Dy_in)                &&
+      SimNextField(c, ia.Dz_in)                &&
+      SimNextField(c, ia.Energy_in)            &&
+      SimNextField(c, ia.OutgoingParticleCode) &&
+      SimNextField(c, ia.Px_out)               &&
+      SimNextField(c, ia.Py_out)               &&
+      SimNextField(c, ia.Pz_out)               &&
+      SimNextField(c, ia.Dx_out)               &&
+      SimNextField(c, ia.Dy_out)               &&
+      SimNextField(c, ia.Dz_out)               &&
+      SimNextField(c, ia.Energy_out);
+
+    // truncated line: the old parser skipped it
+    if (!ok) fEvent.Interactions.pop_back();
+  }
+
+  void ParseHit(SimLineCursor& c)
+  {
+    fEvent.Hits.emplace_back();
+    HitData& hit = fEvent.Hits.back();
+    if (!fIDPool.empty()) {
+      hit.PrimaryParticleIDs.swap(fIDPool.back());
+      fIDPool.pop_back();
+      hit.PrimaryParticleIDs.clear();
+    }
+    hit.Multiplicity = 0;
+
+    const bool ok =
+      SimNextField(c, hit.Index)         &&
+      SimNextField(c, hit.X)             &&
+      SimNextField(c, hit.Y)             &&
+      SimNextField(c, hit.Z)             &&
+      SimNextField(c, hit.EnergyDeposit) &&
+      SimNextField(c, hit.Time);
+
+    if (!ok) {
+      fIDPool.push_back(std::move(hit.PrimaryParticleIDs));
+      fEvent.Hits.pop_back();
+      return;
+    }
+
+    // a blank field re-uses the previous ID, as stringstream >> did
+    Int_t particleID = 0;
+    while (SimNextField(c, particleID)) {
+      hit.PrimaryParticleIDs.push_back(particleID);
+    }
+    hit.Multiplicity = static_cast<Int_t>(hit.PrimaryParticleIDs.size());
+  }
+
+  RunInfo&   fRunInfo;
+  EventData& fEvent;
+  bool       fStarted;
+  bool       fDone;
+
+  std::vector<std::vector<Int_t>> fIDPool;
+};
+
+#endif // SIMPARSER_H
@@ -1,7 +1,10 @@
 #ifndef EVENT_DISPLAY_H
 #define EVENT_DISPLAY_H
 
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "TTree.h"
@@ -21,10 +24,76 @@
 // Importa le strutture dati comuni:
 #include "EventData.h"
 
-// Qui metti SOLO dichiarazioni legate al display.
-// Esempio (adatta ai tuoi nomi reali):
+class FlatEventReader;
+
+// -------------------------------------------------------------------
+// Sessione di display: il file resta aperto fra un evento e l'altro,
+// EventID -> entry calcolato una volta all'apertura (dal .idx.root se
+// c'e'), e gli eventi vicini a quello disegnato restano in memoria
+// (prefetch entries prima e dopo), cosi' Next()/Previous() non
+// rileggono dal disco. Legge "Events" o "EventsFlat".
+// -------------------------------------------------------------------
+class EventDisplaySession {
+ public:
+  explicit EventDisplaySession(const char* input_root_file,
+                               bool onlyIndex1Hits = true,
+                               int  prefetch = 2);
+  ~EventDisplaySession();
+
+  bool     IsValid()    const { return fTree != nullptr; }
+  Long64_t GetEntries() const { return fTree ? fTree->GetEntries() : 0; }
+  Long64_t GetCurrent() const { return fCurrent; }
+  const std::string& GetFileName()       const { return fFileName; }
+  bool               GetOnlyIndex1Hits() const { return fOnlyIndex1Hits; }
+
+  // -1 se l'EventID non e' nel file
+  Long64_t FindEntry(Int_t eventID) const;
+
+  // canvas == nullptr: canvas "c1" (riusata se esiste gia')
+  bool DrawEntry(Long64_t entry, TCanvas* canvas = nullptr);
+  bool DrawEventID(Int_t eventID, TCanvas* canvas = nullptr);
+  bool Next(TCanvas* canvas = nullptr)     { return DrawEntry(fCurrent + 1, canvas); }
+  bool Previous(TCanvas* canvas = nullptr) { return DrawEntry(fCurrent - 1, canvas); }
+
+ private:
+  const EventData* Load(Long64_t entry);
+  void             Prefetch(Long64_t entry);
+
+  std::string                       fFileName;
+  bool                              fOnlyIndex1Hits;
+  int                               fPrefetch;
+  TFile*                            fFile = nullptr;
+  TTree*                            fTree = nullptr;
+  EventData*                        fEvent = nullptr;      // tree "Events"
+  std::unique_ptr<FlatEventReader>  fFlatReader;          // tree "EventsFlat"
+  EventData                         fFlatEvent;
+  std::unordered_map<Int_t, Long64_t> fEntryOfEventID;
+  std::map<Long64_t, EventData>     fCache;
+  Long64_t                          fCurrent = -1;
+};
+
+// Display interattivo: la sessione resta aperta fra una chiamata e
+// l'altra sullo stesso file (stessa scelta di onlyIndex1Hits)
 void EventDisplay(const char* input_root_file,
                   Long64_t entry = 0,
                   bool onlyIndex1Hits = true);
 
+void EventDisplayByID(const char* input_root_file,
+                      Int_t eventID,
+                      bool onlyIndex1Hits = true);
+
+// evento successivo / precedente della sessione aperta
+void EventDisplayNext();
+void EventDisplayPrevious();
+
+// Batch (senza grafica): un PNG per ogni EventID del TTree "EventList"
+// (WriteEventListRoot) in output_dir/event_<EventID>.png, con nWorkers
+// processi (fork) in parallelo (nWorkers <= 0: tutti i core).
+// Restituisce il numero di eventi non disegnati.
+int RenderEventList(const char* input_root_file,
+                    const char* event_list_file,
+                    const char* output_dir = "event_display_png",
+                    int         nWorkers = 0,
+                    bool        onlyIndex1Hits = false);
+
 #endif
@@ -13,9 +13,14 @@
 #include <string>
 #include <vector>
 #include <iosfwd>   // per std::istream forward-declare
+
+#include "EventData.h"
+#include "EventConsumer.h"
+
 class TTree;
 struct RunInfo;
 struct EventData;
+class SimByteSource;
 
 // core riutilizzabile
 void parse_and_fill_tree_core(std::istream& input,
@@ -23,7 +28,61 @@ void parse_and_fill_tree_core(std::istream& input,
                               RunInfo&      runInfo,
                               EventData&    event);
 
-// vecchia interfaccia .sim -> .root
-void parse_and_fill_tree(const char* inputFile, const char* outputFile);
+// stessa cosa, da una sorgente di byte qualsiasi (es. SimDecompressStream)
+void parse_and_fill_tree_core(SimByteSource& source,
+                              TTree&         tree,
+                              RunInfo&       runInfo,
+                              EventData&     event);
+
+// parsing multi-thread di un .sim non compresso, ordine degli eventi
+// preservato (nThreads <= 0: tutti i core)
+bool parse_and_fill_tree_parallel(const char* simFile,
+                                  TTree&      tree,
+                                  RunInfo&    runInfo,
+                                  EventData&  event,
+                                  int         nThreads);
+
+// pipeline single-pass: ogni evento va a tutti i consumer, nell'ordine
+// del file; Begin() dopo l'header, End() alla fine. Restituisce false
+// se l'input non si apre o non contiene TB.
+bool parse_sim_to_consumers(SimByteSource&                     source,
+                            const std::vector<EventConsumer*>& consumers);
+
+// stessa cosa da file: .gz/.xz/.zst decompressi in streaming, .sim
+// parsato in parallelo se nThreads != 1
+bool parse_sim_file_to_consumers(const char*                        simFile,
+                                 const std::vector<EventConsumer*>& consumers,
+                                 int                                nThreads = 1);
+
+// -------------------------------------------------------------------
+// Consumer che scrive il TTree "Events" (RunInfo + Event) in un .root,
+// con lo stesso layout di parse_and_fill_tree
+// -------------------------------------------------------------------
+class SimTreeWriter : public EventConsumer {
+ public:
+  explicit SimTreeWriter(const char* outputFile);
+  ~SimTreeWriter() override;
+
+  void Begin(const RunInfo& runInfo) override;
+  void Consume(const EventData& event) override;
+  void End() override;
+
+ private:
+  std::string fOutputFile;
+  TFile*      fFile = nullptr;
+  TTree*      fTree = nullptr;
+  RunInfo     fRunInfo;
+  EventData   fEvent;
+};
+
+// vecchia interfaccia .sim -> .root (nThreads != 1: parsing parallelo)
+void parse_and_fill_tree(const char* inputFile, const char* outputFile, int nThreads = 1);
+
+// .sim / .sim.gz -> .root con il TTree colonnare "EventsFlat"
+// (vedi FlatEvents.h); nThreads != 1: parsing parallelo
+void parse_and_fill_tree_flat(const char* inputFile, const char* outputFile, int nThreads = 1);
+
+// .sim.gz (.xz/.zst) -> .root, decompressione in streaming
+void parse_and_fill_tree_gz(const char* inputGzFile, const char* outputRootFile);
 
 #endif
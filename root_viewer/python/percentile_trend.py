@@ -1,74 +1,39 @@
-import re
+import csv
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
 from scipy.interpolate import make_interp_spline
 
-# Nome del file di input
-file_path = "/home/frassa/MEGAlib/docker/Percentile_max.txt"
+# Tabella CSV scritta da PercentileTable() (ProducePlots.C):
+# energy_keV,pitch_um,spectrum,quantile,value_keV,entries
+file_path = sys.argv[1] if len(sys.argv) > 1 else "percentiles.csv"
+# Spettro da usare: "MAX" (deposito massimo per layer) o "ALL" (tutti i colpi)
+spectrum = sys.argv[2] if len(sys.argv) > 2 else "MAX"
 
 # Dizionario per contenere i dati:
 # struttura: dati[pitch] = {"energy": [], "p90": [], "p95": [], "p99": []}
 dati = {}
 
-# Regex per riconoscere le righe di pitch e le energie
-pitch_pattern = re.compile(r'^Pitch\s+([\d.]+)um', re.IGNORECASE)
-energy_pattern = re.compile(r'^(\d+(?:\.\d+)?)\s*keV', re.IGNORECASE)
-percent_pattern = re.compile(r'(\d+)\w*\s+Percentile:\s*([0-9.]+)', re.IGNORECASE)
-
-with open(file_path, "r", encoding="utf-8") as f:
-    lines = [line.strip() for line in f if line.strip()]
-
-current_pitch = None
-i = 0
-while i < len(lines):
-    line = lines[i]
-
-    # 1) Riconosciamo il pitch
-    m_pitch = pitch_pattern.match(line)
-    if m_pitch:
-        current_pitch = m_pitch.group(1)  # es. "31.25", "62.50", "125"
-        if current_pitch not in dati:
-            dati[current_pitch] = {"energy": [], "p90": [], "p95": [], "p99": []}
-        i += 1
-        continue
-
-    # 2) Riconosciamo l'energia (es. "100 keV" o "500keV")
-    m_energy = energy_pattern.match(line)
-    if m_energy and current_pitch is not None:
-        energy_val = float(m_energy.group(1))
-
-        # Leggiamo le tre righe successive con i percentili
-        if i + 3 > len(lines):
-            raise ValueError("Formato file inaspettato: mancano righe di percentile.")
-
-        p90_line = lines[i + 1]
-        p95_line = lines[i + 2]
-        p99_line = lines[i + 3]
-
-        # Estrazione dei numeri dai percentili
-        m_p90 = percent_pattern.search(p90_line)
-        m_p95 = percent_pattern.search(p95_line)
-        m_p99 = percent_pattern.search(p99_line)
-
-        if not (m_p90 and m_p95 and m_p99):
-            raise ValueError(f"Formato percentile inaspettato vicino a: {line}")
-
-        p90_val = float(m_p90.group(2))
-        p95_val = float(m_p95.group(2))
-        p99_val = float(m_p99.group(2))
-
-        # Salviamo nei vettori del pitch corrente
-        dati[current_pitch]["energy"].append(energy_val)
-        dati[current_pitch]["p90"].append(p90_val)
-        dati[current_pitch]["p95"].append(p95_val)
-        dati[current_pitch]["p99"].append(p99_val)
-
-        # Avanziamo oltre energia + 3 righe di percentile
-        i += 4
-        continue
-
-    # Se la riga non è né Pitch né energia, passa avanti
-    i += 1
+# prima raccogliamo i percentili per (pitch, energia), poi li ordiniamo per energia
+punti = {}
+with open(file_path, "r", encoding="utf-8", newline="") as f:
+    for row in csv.DictReader(f):
+        if row["spectrum"] != spectrum:
+            continue
+        chiave = (float(row["pitch_um"]), float(row["energy_keV"]))
+        quantile = round(float(row["quantile"]) * 100)
+        punti.setdefault(chiave, {})[f"p{quantile}"] = float(row["value_keV"])
+
+for (pitch, energy_val), perc in sorted(punti.items()):
+    if not all(k in perc for k in ("p90", "p95", "p99")):
+        raise ValueError(f"Percentili mancanti per pitch {pitch} um, {energy_val} keV")
+    current_pitch = f"{pitch:g}"
+    if current_pitch not in dati:
+        dati[current_pitch] = {"energy": [], "p90": [], "p95": [], "p99": []}
+    dati[current_pitch]["energy"].append(energy_val)
+    dati[current_pitch]["p90"].append(perc["p90"])
+    dati[current_pitch]["p95"].append(perc["p95"])
+    dati[current_pitch]["p99"].append(perc["p99"])
 
 # --- Plot dei risultati ---
 
@@ -0,0 +1,511 @@
+"""Campagna di analisi (energie x pitch): tanti .sim / .sim.gz -> .ana.root.
+
+Ogni run e' un processo `root -b -q` che chiama ProcessSimFileTo()
+(AnalyzeEvents.C); i run vanno in parallelo su un pool locale, con un
+limite sul numero di job e sulla memoria disponibile (/proc/meminfo).
+
+Un run viene saltato se il suo .ana.root e' aggiornato: stesso hash
+(sha256) del contenuto dell'input e stessa impronta dei parametri
+(opzioni + sorgenti delle macro). Lo stato e' in un file JSON scritto
+in modo atomico dopo ogni run, quindi dopo un crash basta rilanciare lo
+stesso comando: i run finiti vengono saltati, quelli interrotti rifatti.
+Ogni .ana.root viene scritto come <nome>.part e rinominato solo a run
+completato (con --keep-sim-root anche il .sim.root e il suo .idx.root).
+
+Alla fine CampaignSummary() (TreeVSTree.C) scrive un CSV con una riga
+per run: percentili, e confronto con un run di riferimento.
+
+Uso:
+  python run_campaign.py /data/sim/ --jobs 8 --reference-pitch 62.5
+  python run_campaign.py campaign.txt --out-dir /data/sim_ana
+dove campaign.txt ha una riga per run: <file.sim[.gz]> [energy_keV] [pitch_um]
+"""
+
+import argparse
+import concurrent.futures
+import hashlib
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import threading
+import time
+
+MACRO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SIM_EXTENSIONS = (".sim", ".sim.gz", ".sim.xz", ".sim.zst")
+COMPRESSION_EXTENSIONS = (".gz", ".xz", ".zst")
+
+# macro caricate da ogni job (ordine di caricamento)
+ANALYSIS_MACROS = ("parse_and_fill_tree.C", "AnalyzeEvents.C")
+SUMMARY_MACROS = ("TreeVSTree.C",)
+
+# energia e pitch dal nome del file, se non sono nel manifest
+energy_pattern = re.compile(r"(\d+(?:\.\d+)?)\s*keV", re.IGNORECASE)
+pitch_pattern = re.compile(r"(\d+(?:\.\d+)?)\s*um", re.IGNORECASE)
+
+STATE_VERSION = 1
+
+
+# ---------------------------------------------------------------------
+# Input
+# ---------------------------------------------------------------------
+def is_sim_file(path):
+    return path.endswith(SIM_EXTENSIONS)
+
+
+def number_or_none(text):
+    if text is None or text == "-":
+        return None
+    return float(text)
+
+
+def guess_from_name(path, pattern):
+    m = pattern.search(os.path.basename(path))
+    return float(m.group(1)) if m else None
+
+
+def make_run(path, energy=None, pitch=None):
+    path = os.path.abspath(path)
+    if energy is None:
+        energy = guess_from_name(path, energy_pattern)
+    if pitch is None:
+        pitch = guess_from_name(path, pitch_pattern)
+    return {"input": path, "energy": energy, "pitch": pitch}
+
+
+def read_manifest(manifest):
+    base = os.path.dirname(os.path.abspath(manifest))
+    runs = []
+    with open(manifest, "r", encoding="utf-8") as f:
+        for line in f:
+            fields = line.split()
+            if not fields or fields[0].startswith("#"):
+                continue
+            path = fields[0]
+            if not os.path.isabs(path):
+                path = os.path.join(base, path)
+            energy = number_or_none(fields[1]) if len(fields) > 1 else None
+            pitch = number_or_none(fields[2]) if len(fields) > 2 else None
+            runs.append(make_run(path, energy, pitch))
+    return runs
+
+
+def collect_runs(inputs):
+    runs = []
+    for item in inputs:
+        if os.path.isdir(item):
+            for root, _, files in os.walk(item):
+                for name in sorted(files):
+                    if is_sim_file(name):
+                        runs.append(make_run(os.path.join(root, name)))
+        elif is_sim_file(item):
+            runs.append(make_run(item))
+        else:
+            runs.extend(read_manifest(item))
+
+    # stesso input elencato due volte: un solo run
+    unique = {}
+    for run in runs:
+        unique.setdefault(run["input"], run)
+    return sorted(unique.values(), key=lambda r: r["input"])
+
+
+# stesso nome di AnaOutputFromSim() in AnalyzeEvents.C:
+# .sim[.gz] -> .ana.root, /sim/ -> /sim_ana/
+def ana_output_for(sim_path, out_dir):
+    name = sim_path
+    for ext in COMPRESSION_EXTENSIONS:
+        if name.endswith(ext):
+            name = name[: -len(ext)]
+            break
+    pos = name.rfind(".sim")
+    name = name[:pos] + ".ana.root" if pos >= 0 else name + ".ana.root"
+
+    if out_dir:
+        return os.path.join(os.path.abspath(out_dir), os.path.basename(name))
+    return name.replace("/sim/", "/sim_ana/", 1)
+
+
+# ---------------------------------------------------------------------
+# Hash e impronta dei parametri
+# ---------------------------------------------------------------------
+def sha256_file(path, block=1 << 20):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        while True:
+            data = f.read(block)
+            if not data:
+                break
+            h.update(data)
+    return h.hexdigest()
+
+
+def params_fingerprint(args):
+    # le opzioni che cambiano il .ana.root + il codice che lo produce
+    h = hashlib.sha256()
+    h.update(json.dumps({"threads": args.threads,
+                         "keep_sim_root": args.keep_sim_root}, sort_keys=True).encode())
+    sources = sorted(f for f in os.listdir(MACRO_DIR) if f.endswith(".h"))
+    sources += list(ANALYSIS_MACROS)
+    for name in sources:
+        h.update(name.encode())
+        h.update(sha256_file(os.path.join(MACRO_DIR, name)).encode())
+    return h.hexdigest()
+
+
+# ---------------------------------------------------------------------
+# Stato della campagna (JSON, scrittura atomica)
+# ---------------------------------------------------------------------
+class CampaignState:
+    def __init__(self, path):
+        self.path = path
+        self.lock = threading.Lock()
+        self.runs = {}
+        if os.path.exists(path):
+            with open(path, "r", encoding="utf-8") as f:
+                data = json.load(f)
+            if data.get("version") == STATE_VERSION:
+                self.runs = data.get("runs", {})
+
+        # run rimasti "running" da una sessione interrotta: da rifare
+        for entry in self.runs.values():
+            if entry.get("status") == "running":
+                entry["status"] = "interrupted"
+
+    def get(self, key):
+        with self.lock:
+            return dict(self.runs.get(key, {}))
+
+    def update(self, key, **fields):
+        with self.lock:
+            self.runs.setdefault(key, {}).update(fields)
+            self._save()
+
+    def _save(self):
+        directory = os.path.dirname(self.path) or "."
+        os.makedirs(directory, exist_ok=True)
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump({"version": STATE_VERSION, "runs": self.runs}, f, indent=1, sort_keys=True)
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(tmp, self.path)
+
+
+def input_hash(state, run):
+    # l'hash dell'input viene riusato se dimensione e mtime non sono cambiati
+    st = os.stat(run["input"])
+    previous = state.get(run["input"])
+    if previous.get("input_size") == st.st_size and previous.get("input_mtime_ns") == st.st_mtime_ns \
+            and previous.get("input_sha256"):
+        return previous["input_sha256"], st
+    return sha256_file(run["input"]), st
+
+
+def up_to_date(entry, sha, params, output):
+    return (entry.get("status") == "done"
+            and entry.get("input_sha256") == sha
+            and entry.get("params") == params
+            and os.path.exists(output)
+            and os.path.getsize(output) == entry.get("output_size"))
+
+
+# ---------------------------------------------------------------------
+# Memoria disponibile
+# ---------------------------------------------------------------------
+def mem_available_gb():
+    try:
+        with open("/proc/meminfo", "r") as f:
+            for line in f:
+                if line.startswith("MemAvailable:"):
+                    return int(line.split()[1]) / (1024.0 * 1024.0)
+    except OSError:
+        pass
+    return None  # sconosciuta: nessun limite
+
+
+def process_rss_gb(pids):
+    """RSS (GB) di ogni pid in pids, figli e nipoti compresi (root -> root.exe).
+
+    Un solo giro su /proc; 0 se /proc non c'e'.
+    """
+    parent = {}
+    rss = {}
+    page_gb = os.sysconf("SC_PAGE_SIZE") / (1024.0 ** 3) if hasattr(os, "sysconf") else 0.0
+    try:
+        entries = os.listdir("/proc")
+    except OSError:
+        return {pid: 0.0 for pid in pids}
+    for entry in entries:
+        if not entry.isdigit():
+            continue
+        try:
+            with open("/proc/%s/stat" % entry, "r") as f:
+                stat = f.read()
+        except OSError:
+            continue
+        # dopo "(comm) ": state ppid ... rss e' il 22esimo campo
+        fields = stat[stat.rfind(")") + 2:].split()
+        if len(fields) > 21:
+            parent[int(entry)] = int(fields[1])
+            rss[int(entry)] = int(fields[21]) * page_gb
+
+    result = {}
+    for pid in pids:
+        total = 0.0
+        for proc, proc_rss in rss.items():
+            ancestor = proc
+            while ancestor > 1 and ancestor != pid:
+                ancestor = parent.get(ancestor, 0)
+            if ancestor == pid:
+                total += proc_rss
+        result[pid] = total
+    return result
+
+
+def unshown_memory_gb(args, running, pids):
+    """Memoria dei job in corso non ancora visibile in MemAvailable.
+
+    Ogni job tiene una prenotazione di --mem-per-job, che scende man mano
+    che il suo processo alloca (RSS): un job appena partito conta per
+    intero, uno arrivato a regime non conta piu' (e' gia' in MemAvailable).
+    """
+    started = [pids.get(run["input"]) for run in running.values()]
+    rss = process_rss_gb([pid for pid in started if pid])
+    return sum(max(0.0, args.mem_per_job - (rss.get(pid, 0.0) if pid else 0.0))
+               for pid in started)
+
+
+# ---------------------------------------------------------------------
+# Esecuzione ROOT
+# ---------------------------------------------------------------------
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def root_command(args, macros, call):
+    cmd = [args.root, "-l", "-b", "-q"]
+    for macro in macros:
+        cmd += ["-e", ".L " + os.path.join(MACRO_DIR, macro) + "+"]
+    if call:
+        cmd += ["-e", call]
+    return cmd
+
+
+def compile_macros(args, macros):
+    # una volta sola, prima del pool: i job non compilano in parallelo
+    # le stesse librerie ACLiC
+    result = subprocess.run(root_command(args, macros, None),
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout)
+        raise SystemExit("ERROR: compilation of %s failed" % ", ".join(macros))
+
+
+def process_run(args, state, run, sha, st, params, pids):
+    output = run["output"]
+    part = output + ".part"
+    log_path = output + ".log"
+    os.makedirs(os.path.dirname(output), exist_ok=True)
+
+    # .sim.root (e il suo .idx.root) anche loro sotto un nome temporaneo:
+    # <run>.part.sim.root -> <run>.part.idx.root (EventIndexFileFor)
+    stem = output[: -len(".ana.root")]
+    renames = [(part, output)]
+    sim_root = "nullptr"
+    if args.keep_sim_root:
+        sim_root = c_string(stem + ".part.sim.root")
+        renames += [(stem + ".part.sim.root", stem + ".sim.root"),
+                    (stem + ".part.idx.root", stem + ".idx.root")]
+    for temporary, _ in renames:
+        if os.path.exists(temporary):
+            os.remove(temporary)
+    # ProcessSimFileTo restituisce false se il run fallisce: exit status 1
+    call = "if (!ProcessSimFileTo(%s, %s, %d, %s)) gSystem->Exit(1);" % (
+        c_string(run["input"]), c_string(part), args.threads, sim_root)
+
+    state.update(run["input"], status="running", output=output, started=time.time())
+    start = time.time()
+    with open(log_path, "w", encoding="utf-8") as log:
+        proc = subprocess.Popen(root_command(args, ANALYSIS_MACROS, call),
+                                stdout=log, stderr=subprocess.STDOUT)
+        pids[run["input"]] = proc.pid
+        try:
+            returncode = proc.wait()
+        finally:
+            pids.pop(run["input"], None)
+    elapsed = time.time() - start
+
+    # senza eventi (o con un errore) il .ana.root non viene scritto
+    missing = [t for t, _ in renames if not os.path.exists(t) or os.path.getsize(t) == 0]
+    if returncode != 0 or missing:
+        for temporary, _ in renames:
+            if os.path.exists(temporary):
+                os.remove(temporary)
+        state.update(run["input"], status="failed", returncode=returncode,
+                     seconds=round(elapsed, 1), log=log_path)
+        return False, elapsed
+
+    # il .ana.root per ultimo: e' lui che segna il run come finito
+    for temporary, final in renames[1:] + renames[:1]:
+        os.replace(temporary, final)
+    state.update(run["input"], status="done", output=output,
+                 output_size=os.path.getsize(output),
+                 input_sha256=sha, input_size=st.st_size, input_mtime_ns=st.st_mtime_ns,
+                 params=params, energy=run["energy"], pitch=run["pitch"],
+                 seconds=round(elapsed, 1), log=log_path, finished=time.time())
+    return True, elapsed
+
+
+def run_pool(args, state, todo, params):
+    failed = []
+    pending = list(todo)
+    running = {}
+    pids = {}   # input -> pid del processo root del job
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        while pending or running:
+            # nuovi job finche' ci sono posti e memoria: i job appena
+            # partiti non hanno ancora allocato, la loro prenotazione conta
+            while pending and len(running) < args.jobs:
+                avail = mem_available_gb()
+                if running and avail is not None:
+                    committed = unshown_memory_gb(args, running, pids)
+                    if avail - args.mem_reserve - committed < args.mem_per_job:
+                        break
+                run, sha, st = pending.pop(0)
+                print("[start] %s (%d running)" % (run["input"], len(running) + 1), flush=True)
+                future = pool.submit(process_run, args, state, run, sha, st, params, pids)
+                running[future] = run
+
+            done, _ = concurrent.futures.wait(list(running), timeout=5.0,
+                                              return_when=concurrent.futures.FIRST_COMPLETED)
+            for future in done:
+                run = running.pop(future)
+                try:
+                    ok, elapsed = future.result()
+                except Exception as err:  # noqa: BLE001 -- un run fallito non ferma la campagna
+                    state.update(run["input"], status="failed", error=str(err))
+                    ok, elapsed = False, 0.0
+                print("[%s] %s (%.0f s)" % ("done" if ok else "FAILED", run["input"], elapsed),
+                      flush=True)
+                if not ok:
+                    failed.append(run)
+    return failed
+
+
+# ---------------------------------------------------------------------
+# Riassunto della campagna
+# ---------------------------------------------------------------------
+def reference_for(args, run, runs):
+    if args.reference:
+        return os.path.abspath(args.reference)
+    if args.reference_pitch is None or run["energy"] is None:
+        return None
+    for other in runs:
+        if other["energy"] == run["energy"] and other["pitch"] == args.reference_pitch:
+            return other["output"]
+    return None
+
+
+def write_summary(args, state, runs):
+    done = [r for r in runs if state.get(r["input"]).get("status") == "done"]
+    if not done:
+        print("No completed runs, no summary.")
+        return
+
+    summary = os.path.abspath(args.summary)
+    manifest = os.path.splitext(summary)[0] + ".txt"
+    with open(manifest, "w", encoding="utf-8") as f:
+        f.write("# <file.ana.root> <energy_keV> <pitch_um> <reference.ana.root>\n")
+        for run in done:
+            reference = reference_for(args, run, done)
+            f.write("%s %s %s %s\n" % (run["output"],
+                                       "-" if run["energy"] is None else "%g" % run["energy"],
+                                       "-" if run["pitch"] is None else "%g" % run["pitch"],
+                                       reference or "-"))
+
+    call = "CampaignSummary(%s, %s)" % (c_string(manifest), c_string(summary))
+    result = subprocess.run(root_command(args, SUMMARY_MACROS, call))
+    if result.returncode != 0:
+        print("ERROR: CampaignSummary failed", file=sys.stderr)
+
+
+# ---------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("inputs", nargs="+",
+                        help="directory con .sim/.sim.gz, file .sim, o manifest")
+    parser.add_argument("--out-dir", help="directory dei .ana.root (default: /sim/ -> /sim_ana/)")
+    parser.add_argument("--jobs", type=int, default=0,
+                        help="run in parallelo (default: core / threads)")
+    parser.add_argument("--threads", type=int, default=1,
+                        help="nThreads di ProcessSimFileTo per ogni run")
+    parser.add_argument("--mem-per-job", type=float, default=1.5,
+                        help="memoria stimata per run, GB (prenotata finche' il run non la usa)")
+    parser.add_argument("--mem-reserve", type=float, default=1.0,
+                        help="memoria da lasciare libera, GB")
+    parser.add_argument("--keep-sim-root", action="store_true",
+                        help="scrive anche il .sim.root di ogni run")
+    parser.add_argument("--state", help="file di stato (default: campaign_state.json)")
+    parser.add_argument("--summary", default="campaign_summary.csv")
+    parser.add_argument("--reference", help=".ana.root di riferimento per tutti i run")
+    parser.add_argument("--reference-pitch", type=float,
+                        help="riferimento: il run con la stessa energia e questo pitch")
+    parser.add_argument("--no-summary", action="store_true")
+    parser.add_argument("--force", action="store_true", help="rifa' anche i run aggiornati")
+    parser.add_argument("--dry-run", action="store_true", help="elenca solo cosa farebbe")
+    parser.add_argument("--root", default="root", help="eseguibile di ROOT")
+    args = parser.parse_args()
+
+    if args.jobs <= 0:
+        args.jobs = max(1, (os.cpu_count() or 1) // max(1, args.threads))
+    if not args.dry_run and shutil.which(args.root) is None:
+        raise SystemExit("ERROR: ROOT executable not found: " + args.root)
+
+    runs = collect_runs(args.inputs)
+    if not runs:
+        raise SystemExit("ERROR: no .sim files found")
+    for run in runs:
+        run["output"] = ana_output_for(run["input"], args.out_dir)
+
+    state_path = args.state or os.path.join(args.out_dir or os.getcwd(), "campaign_state.json")
+    state = CampaignState(os.path.abspath(state_path))
+    params = params_fingerprint(args)
+
+    todo = []
+    for run in runs:
+        sha, st = input_hash(state, run)
+        if not args.force and up_to_date(state.get(run["input"]), sha, params, run["output"]):
+            print("[skip] %s: up to date" % run["input"])
+            continue
+        todo.append((run, sha, st))
+
+    print("%d runs, %d to process, %d jobs x %d threads" %
+          (len(runs), len(todo), args.jobs, args.threads), flush=True)
+    if args.dry_run:
+        for run, _, _ in todo:
+            print("  %s -> %s" % (run["input"], run["output"]))
+        return 0
+
+    failed = []
+    if todo:
+        compile_macros(args, ANALYSIS_MACROS)
+        failed = run_pool(args, state, todo, params)
+
+    if not args.no_summary:
+        compile_macros(args, SUMMARY_MACROS)
+        write_summary(args, state, runs)
+
+    if failed:
+        print("%d runs FAILED:" % len(failed), file=sys.stderr)
+        for run in failed:
+            print("  %s (log: %s.log)" % (run["input"], run["output"]), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())